@@ -0,0 +1,110 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <arena.h>
+
+/* Chunk headers are padded so chunk memory starts aligned. */
+#define ARENA_HEADER \
+  ((sizeof(arena_chunk_t) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+static arena_chunk_t *arena_new_chunk(arena_t *arena, size_t size) {
+  arena_chunk_t *chunk;
+
+  chunk = (arena_chunk_t*)malloc(ARENA_HEADER + size);
+  assert(chunk);
+  chunk->size = size;
+  arena->reserved += ARENA_HEADER + size;
+  return chunk;
+}
+
+void arena_init(arena_t *arena) {
+  arena->chunks = NULL;
+  arena->next = arena->end = NULL;
+  arena->used = arena->reserved = 0;
+  arena->chunk_size = ARENA_MIN_CHUNK_SIZE;
+}
+
+void *arena_alloc(arena_t *arena, size_t size) {
+  arena_chunk_t *chunk;
+  void *p;
+
+  size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+  arena->used += size;
+
+  /* Big requests get a chunk of their own, kept behind the current one
+   * so the space left in it is not wasted. */
+  if (size > ARENA_CHUNK_SIZE / 4) {
+    chunk = arena_new_chunk(arena, size);
+    if (arena->chunks) {
+      chunk->next = arena->chunks->next;
+      arena->chunks->next = chunk;
+    } else {
+      chunk->next = NULL;
+      arena->chunks = chunk;
+    }
+    return (char*)chunk + ARENA_HEADER;
+  }
+
+  if (arena->next == NULL || arena->end - arena->next < size) {
+    while (arena->chunk_size < size)
+      arena->chunk_size *= 2;
+    chunk = arena_new_chunk(arena, arena->chunk_size);
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    arena->next = (char*)chunk + ARENA_HEADER;
+    arena->end = arena->next + arena->chunk_size;
+    if (arena->chunk_size < ARENA_CHUNK_SIZE)
+      arena->chunk_size *= 2;
+  }
+  p = arena->next;
+  arena->next += size;
+  return p;
+}
+
+void *arena_calloc(arena_t *arena, size_t n, size_t size) {
+  void *p = arena_alloc(arena, n * size);
+  memset(p, 0, n * size);
+  return p;
+}
+
+void arena_release(arena_t *arena) {
+  arena_chunk_t *chunk, *next;
+
+  for (chunk = arena->chunks; chunk; chunk = next) {
+    next = chunk->next;
+    free(chunk);
+  }
+  arena_init(arena);
+}
+
+void arena_test() {
+  arena_t arena;
+  char *a, *b, *big;
+  int i;
+
+  printf("Testing arenas\n");
+  arena_init(&arena);
+  a = arena_alloc(&arena, 1);
+  b = arena_alloc(&arena, 24);
+  assert(((size_t)a % ARENA_ALIGN) == 0 && ((size_t)b % ARENA_ALIGN) == 0);
+  assert(b == a + ARENA_ALIGN);
+  assert(arena.used == ARENA_ALIGN + 32);
+
+  /* a big allocation must not disturb the current chunk */
+  big = arena_calloc(&arena, ARENA_CHUNK_SIZE, 1);
+  for (i = 0; i < ARENA_CHUNK_SIZE; i++)
+    assert(big[i] == 0);
+  assert(arena_alloc(&arena, 16) == b + 32);
+
+  /* filling the current chunk starts a new, bigger one */
+  assert(arena.reserved < ARENA_CHUNK_SIZE + 2 * ARENA_MIN_CHUNK_SIZE);
+  for (i = 0; i < ARENA_CHUNK_SIZE / 4096; i++)
+    arena_alloc(&arena, 4096);
+  assert(arena.reserved >= 2 * ARENA_CHUNK_SIZE);
+  assert(arena.chunk_size == ARENA_CHUNK_SIZE);
+
+  arena_release(&arena);
+  assert(arena.chunks == NULL && arena.used == 0 && arena.reserved == 0);
+}
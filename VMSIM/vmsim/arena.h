@@ -0,0 +1,51 @@
+/*
+ * arena.h - Region allocator. Memory is carved out of large chunks by
+ *           bumping a pointer and is only ever released all at once, which
+ *           suits structures like the page table that grow for the whole
+ *           simulation and are thrown away together: no per-object malloc
+ *           header, neighbours allocated together stay together, and
+ *           teardown is one pass over the chunks.
+ *
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <vmsim.h>
+
+/* Chunks start small, so that many small arenas stay cheap, and double
+ * up to ARENA_CHUNK_SIZE. */
+#define ARENA_MIN_CHUNK_SIZE (1 << 14)
+#define ARENA_CHUNK_SIZE (1 << 20)
+/* Every allocation is aligned to this many bytes. */
+#define ARENA_ALIGN 16
+
+typedef struct _arena_chunk {
+  struct _arena_chunk *next;
+  size_t size; /* bytes of memory following this header */
+} arena_chunk_t;
+
+typedef struct _arena {
+  arena_chunk_t *chunks; /* the current chunk is first */
+  char *next;            /* free space in the current chunk */
+  char *end;
+  size_t chunk_size;     /* size of the next chunk */
+  size_t used;           /* bytes handed out, including alignment */
+  size_t reserved;       /* bytes obtained from malloc */
+} arena_t;
+
+void arena_init(arena_t *arena);
+
+/* Allocate size bytes; the memory is uninitialized. */
+void *arena_alloc(arena_t *arena, size_t size);
+
+/* Allocate zeroed memory for n objects of the given size. */
+void *arena_calloc(arena_t *arena, size_t n, size_t size);
+
+/* Release everything allocated from the arena. It may then be reused. */
+void arena_release(arena_t *arena);
+
+void arena_test();
+
+#endif /* ARENA_H */
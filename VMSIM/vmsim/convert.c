@@ -0,0 +1,51 @@
+/*
+ * convert.c - vmsim-convert: rewrite a text trace as a binary trace
+ *             that vmsim can mmap and replay without parsing.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <vmsim.h>
+#include <trace.h>
+
+int main(int argc, char **argv) {
+  trace_t *trace;
+  trace_ref_t ref;
+  FILE *fout;
+  ulong count = 0;
+
+  if (argc != 3) {
+    fprintf(stderr, "Usage: vmsim-convert TRACEFILE|- OUTFILE\n");
+    fprintf(stderr, "Convert a text TRACEFILE (or stdin, for '-') to the binary trace format.\n");
+    exit(1);
+  }
+
+  trace = trace_open(argv[1]);
+  if ((fout = fopen(argv[2], "wb")) == NULL) {
+    perror("vmsim-convert: unable to open output file for write");
+    exit(1);
+  }
+
+  trace_write_header(fout);
+  while (trace_next(trace, &ref)) {
+    if (!trace_write_ref(fout, &ref)) {
+      fprintf(stderr,
+	      "vmsim-convert: %s:%lu: pid too large for binary trace\n",
+	      trace->name, trace->line);
+      fclose(fout);
+      unlink(argv[2]);
+      exit(1);
+    }
+    count++;
+  }
+
+  if (fclose(fout) != 0) {
+    perror("vmsim-convert: error writing output file");
+    exit(1);
+  }
+  trace_close(trace);
+  printf("vmsim-convert: wrote %lu references to %s\n", count, argv[2]);
+  return 0;
+}
@@ -1,398 +1,1374 @@
 /*
  * fault.c - Defines the available fault handlers. One example,
- *           fault_random, is provided; be sure to add your handlers 
+ *           fault_random, is provided; be sure to add your handlers
  	     to fault_handlers[].
  *
+ *           Handlers keep no static state: anything they need beyond
+ *           physmem lives in sim->fault_state, created by the handler's
+ *           init function, so any number of simulations can run at once.
+ *
  */
 
 #include <vmsim.h>
 #include <fault.h>
 #include <options.h>
 #include <physmem.h>
+#include <sim.h>
+#include <list.h>
+#include <heap.h>
+#include <trace.h>
+#include <opt.h>
+#include <rng.h>
 #include <stdlib.h>
 #include <stdio.h>
-
-static void fault_random(pte_t *pte, ref_kind_t type);
-static void fault_lfu(pte_t *pte, ref_kind_t type);
-static void fault_mfu(pte_t *pte, ref_kind_t type);
-static void fault_lru(pte_t *pte, ref_kind_t type);
-static void fault_fifo(pte_t *pte, ref_kind_t type);
-static void fault_clock(pte_t *pte, ref_kind_t type);
-static void fault_second(pte_t *pte, ref_kind_t type);
-static void fault_init_random();
-
-fault_handler_info_t fault_handlers[8] = {
-  { "random", fault_random },
-  { "lfu", fault_lfu },
-  { "lru", fault_lru },
-  { "fifo", fault_fifo },
-  { "mfu", fault_mfu },
-  { "clock", fault_clock },
-  { "second", fault_second }, 
-  { NULL, NULL } /* last entry must always be NULL/NULL */
+#include <string.h>
+#include <assert.h>
+
+static void *fault_random_init(sim_t *sim);
+static void fault_random(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void *fault_lfu_init(sim_t *sim);
+static void *fault_mfu_init(sim_t *sim);
+static void fault_freq_fini(void *state);
+static void fault_freq(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void fault_freq_hit(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void *fault_lru_init(sim_t *sim);
+static void fault_lru(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void fault_lru_hit(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void *fault_fifo_init(sim_t *sim);
+static void fault_fifo(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void *fault_clock_init(sim_t *sim);
+static void fault_clock_fini(void *state);
+static void fault_clock(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void fault_clock_hit(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void *fault_second_init(sim_t *sim);
+static void fault_second_fini(void *state);
+static void fault_second(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void fault_second_hit(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void *fault_arc_init(sim_t *sim);
+static void fault_arc(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void fault_arc_hit(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void *fault_lirs_init(sim_t *sim);
+static void fault_lirs(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void fault_lirs_hit(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void *fault_clockpro_init(sim_t *sim);
+static void fault_clockpro_fini(void *state);
+static void fault_clockpro(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void fault_clockpro_hit(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void *fault_wsclock_init(sim_t *sim);
+static void fault_wsclock(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void fault_wsclock_hit(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void *fault_eclock_init(sim_t *sim);
+static void fault_eclock_fini(void *state);
+static void fault_eclock(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void fault_eclock_hit(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void *fault_opt_init(sim_t *sim);
+static void fault_opt_fini(void *state);
+static void fault_opt(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void fault_opt_hit(sim_t *sim, pte_t *pte, ref_kind_t type);
+static void *fault_sampled_init(sim_t *sim);
+static void fault_sampled_fini(void *state);
+static void fault_sampled(sim_t *sim, pte_t *pte, ref_kind_t type);
+
+fault_handler_info_t fault_handlers[15] = {
+  { "random", fault_random, NULL, fault_random_init, NULL },
+  { "lfu", fault_freq, fault_freq_hit, fault_lfu_init, fault_freq_fini },
+  { "lru", fault_lru, fault_lru_hit, fault_lru_init, NULL },
+  { "fifo", fault_fifo, NULL, fault_fifo_init, NULL },
+  { "mfu", fault_freq, fault_freq_hit, fault_mfu_init, fault_freq_fini },
+  { "clock", fault_clock, fault_clock_hit, fault_clock_init,
+    fault_clock_fini },
+  { "second", fault_second, fault_second_hit, fault_second_init,
+    fault_second_fini },
+  { "arc", fault_arc, fault_arc_hit, fault_arc_init, NULL },
+  { "lirs", fault_lirs, fault_lirs_hit, fault_lirs_init, NULL },
+  { "clockpro", fault_clockpro, fault_clockpro_hit, fault_clockpro_init,
+    fault_clockpro_fini },
+  { "wsclock", fault_wsclock, fault_wsclock_hit, fault_wsclock_init, NULL },
+  { "eclock", fault_eclock, fault_eclock_hit, fault_eclock_init,
+    fault_eclock_fini },
+  { "opt", fault_opt, fault_opt_hit, fault_opt_init, fault_opt_fini },
+  { "sampled-lru", fault_sampled, NULL, fault_sampled_init,
+    fault_sampled_fini },
+  { NULL, NULL, NULL, NULL, NULL } /* last entry must always be NULL */
 };
 
-/* Initialize any state needed by the fault handlers here.
+/* Initialize any state needed by the simulation's fault handler here.
  * For example, the random number generator must be initialized for
  * fault_random. */
-void fault_init() {
-  fault_init_random();
+void fault_init(sim_t *sim) {
+  fault_handler_info_t *info = sim->opts.fault_handler;
+  sim->fault_state = info->init ? info->init(sim) : NULL;
 }
 
-void fault_init_random() {
-  long seed = 1234567;
-  srandom(seed);
+void fault_free(sim_t *sim) {
+  fault_handler_info_t *info = sim->opts.fault_handler;
+  if (info->fini)
+    info->fini(sim->fault_state);
+  else
+    free(sim->fault_state);
+  sim->fault_state = NULL;
 }
 
 
 //Random page replacement algorithm
-void fault_random(pte_t *pte, ref_kind_t type) {
+// Each simulation draws from its own generator, seeded by -S.
+typedef struct _random_state {
+  rng_t rng;
+} random_state_t;
+
+static void *fault_random_init(sim_t *sim) {
+  random_state_t *s = (random_state_t*)calloc(1, sizeof(random_state_t));
+  assert(s);
+  rng_seed(&s->rng, sim->opts.seed, RNG_STREAM_RANDOM);
+  return s;
+}
+
+void fault_random(sim_t *sim, pte_t *pte, ref_kind_t type) {
+  random_state_t *s = (random_state_t*)sim->fault_state;
   int page;
-  page = random() % opts.phys_pages;
-  physmem_evict(page, type);
-  physmem_load(page, pte, type);
+  page = rng_below(&s->rng, sim->opts.phys_pages);
+  physmem_evict(sim, page, type);
+  physmem_load(sim, page, pte, type);
 }
 
 
+// LFU and MFU share one implementation: every resident frame sits in an
+// indexed min-heap keyed by (frequency, load order). MFU stores the
+// frequency inverted, so the top of the heap is always the victim and ties
+// go to the page that was loaded first. A hit is an O(log n) increase-key,
+// a fault an O(log n) pop/push, and nothing is allocated after init.
+typedef struct _freq_state {
+	heap_t heap;
+	uint seq;       /* load order, the FIFO tie-break */
+	bool_t most;    /* TRUE for MFU */
+} freq_state_t;
+
+static freq_state_t *fault_freq_init(sim_t *sim, bool_t most) {
+	freq_state_t *s = (freq_state_t*)calloc(1, sizeof(freq_state_t));
+	assert(s);
+	heap_init(&s->heap, sim->opts.phys_pages);
+	s->most = most;
+	return s;
+}
+
 //least frequetly used algorithm - LFU
-void fault_lfu(pte_t *pte, ref_kind_t type) {
+static void *fault_lfu_init(sim_t *sim) {
+	return fault_freq_init(sim, FALSE);
+}
 
-	//printf(" \n\n lfu not implemented yet \n\n");
+//Most frequetly used algorithm - MFU
+static void *fault_mfu_init(sim_t *sim) {
+	return fault_freq_init(sim, TRUE);
+}
 
-	static int frame = 0;
-	
-	int i;
+static void fault_freq_fini(void *state) {
+	freq_state_t *s = (freq_state_t*)state;
+	heap_free(&s->heap);
+	free(s);
+}
 
-	pte_t *test=(pte_t*)malloc(sizeof(pte_t));
+static inline heap_key_t freq_key(freq_state_t *s, uint frequency, uint seq) {
+	if (s->most)
+		frequency = ~frequency;
+	return ((heap_key_t)frequency << 32) | seq;
+}
 
-	//int min_frequency = 0;
-	int loc = 0;
+static inline uint freq_key_frequency(freq_state_t *s, heap_key_t key) {
+	uint frequency = (uint)(key >> 32);
+	return s->most ? ~frequency : frequency;
+}
+
+static void fault_freq(sim_t *sim, pte_t *pte, ref_kind_t type) {
+	freq_state_t *s = (freq_state_t*)sim->fault_state;
+	uint pfn;
 
-	static int check = 1;
-	
 	//for FAULT
-	if(check <= opts.phys_pages)
+	if(s->heap.size < sim->opts.phys_pages)
 	{
-		physmem_load(frame, pte, type);
-		
-		frame = frame + 1;
-		check = check + 1;			
-
+		pfn = s->heap.size;
 	}
 
 	else
 	{
+		pfn = heap_pop(&s->heap);
+		physmem_evict(sim, pfn, type);
+	}
 
-		//min_frequency = physmem[0]->frequency;
-		test->frequency = physmem[0]->frequency;
-		for(i=0;i<opts.phys_pages;i++)
-		{
+	physmem_load(sim, pfn, pte, type);
+	//the faulting reference is the page's first use since it was loaded
+	heap_push(&s->heap, pfn, freq_key(s, 1, s->seq++));
+}
 
-			if(test->frequency > physmem[i]->frequency)
-			{
-				test->frequency = physmem[i]->frequency;
-				loc = i;
-				//min_counter = physmem[i]->frequency;
-				test->c = physmem[i]->c;
-			}
+static void fault_freq_hit(sim_t *sim, pte_t *pte, ref_kind_t type) {
+	freq_state_t *s = (freq_state_t*)sim->fault_state;
+	heap_key_t key = heap_key(&s->heap, pte->pfn);
+	uint frequency = freq_key_frequency(s, key);
+
+	heap_update(&s->heap, pte->pfn,
+		    freq_key(s, frequency + 1, (uint)key));
+}
 
-			
-		}
 
-		//to maintain FIFO order
-		for(i=0;i<opts.phys_pages;i++)
-		{
-			if((physmem[i]->frequency == test->frequency) && (physmem[i]->c < test->c))
-				loc = i;
-		}
 
-		physmem_evict(loc, type);
-  		physmem_load(loc, pte, type);
-		
-	
-	}	
+// LRU replacement
+// Resident pages are kept on an intrusive recency list threaded through
+// pte_t, most recently used first. A hit moves the page to the front and
+// a fault evicts from the back, so both are O(1) regardless of phys_pages.
+static void *fault_lru_init(sim_t *sim) {
+	list_t *lru_list = (list_t*)malloc(sizeof(list_t));
+	assert(lru_list);
+	list_init(lru_list);
+	return lru_list;
+}
 
+void fault_lru(sim_t *sim, pte_t *pte, ref_kind_t type) {
+	list_t *lru_list = (list_t*)sim->fault_state;
+	pte_t *victim;
+	uint pfn;
 
+	if(lru_list->size < sim->opts.phys_pages)
+	{
+		pfn = lru_list->size;
+	}
+
+	else
+	{
+		victim = list_entry(list_pop_back(lru_list), pte_t, lru);
+		pfn = victim->pfn;
+		physmem_evict(sim, pfn, type);
+	}
+
+	physmem_load(sim, pfn, pte, type);
+	list_push_front(lru_list, &pte->lru);
 }
 
+static void fault_lru_hit(sim_t *sim, pte_t *pte, ref_kind_t type) {
+	list_move_front((list_t*)sim->fault_state, &pte->lru);
+}
 
 
-//Most frequetly used algorithm - MFU
-void fault_mfu(pte_t *pte, ref_kind_t type) {
+// Handlers whose only state is how many frames have been filled so far.
+typedef struct _fill_state {
+	int frame;
+	int check;
+} fill_state_t;
 
-	//printf(" \n\n mfu not implemented yet \n\n");
+static void *fault_fill_init() {
+	fill_state_t *s = (fill_state_t*)calloc(1, sizeof(fill_state_t));
+	assert(s);
+	s->check = 1;
+	return s;
+}
 
-	static int frame = 0;
-	
-	int i;
+static void *fault_fifo_init(sim_t *sim) {
+	return fault_fill_init();
+}
 
-	pte_t *test=(pte_t*)malloc(sizeof(pte_t));
 
-	
-	int loc = 0;
 
-	static int check = 1;
-	
-	//for FAULT
-	if(check <= opts.phys_pages)
+// FIFO replacement
+void fault_fifo(sim_t *sim, pte_t *pte, ref_kind_t type) {
+	//printf("FIFO not implemented yet!\n");
+
+	fill_state_t *s = (fill_state_t*)sim->fault_state;
+	uint loc;
+
+	if(s->check <= sim->opts.phys_pages)
 	{
-		physmem_load(frame, pte, type);
-		
-		frame = frame + 1;
-		check = check + 1;			
+		physmem_load(sim, s->frame, pte, type);
+		s->frame = s->frame + 1;
+		s->check = s->check + 1;
+
 
 	}
 
 	else
 	{
 
-		
-		test->frequency = physmem[0]->frequency;
-		for(i=0;i<opts.phys_pages;i++)
-		{
-
-			if(test->frequency < physmem[i]->frequency)
-			{
-				test->frequency = physmem[i]->frequency;
-				loc = i;
-				//min_counter = physmem[i]->frequency;
-				test->c = physmem[i]->c;
-			}
+	/* The frame loaded first */
+	loc = physmem_argmin(sim->frametab.load_order, 0, sim->opts.phys_pages);
 
-			
-		}
+	physmem_evict(sim, loc, type);
+	physmem_load(sim, loc, pte, type);
 
-		
-		for(i=0;i<opts.phys_pages;i++)
-		{
-			if((physmem[i]->frequency == test->frequency) && (physmem[i]->c < test->c))
-				loc = i;
-		}
 
-		physmem_evict(loc, type);
-  		physmem_load(loc, pte, type);
-		
-	
-	}	
 
+}
 }
 
+//Clock replacement algorithm
+// The reference bits of all frames are packed 64 to a word, so the hand
+// sweeps a word at a time: it clears the set bits it passes and stops at
+// the first clear one, found with first_set on the inverted word. A fault
+// costs O(phys_pages / 64) at worst. The hand rests just after the
+// victim, where the next sweep begins.
+#define CLOCK_WORD_BITS 64
+
+typedef struct _clock_state {
+	unsigned long long *ref; /* reference bit of frame i: bit i % 64 of ref[i / 64] */
+	uint words;
+	unsigned long long last_mask; /* the frames that exist in ref[words - 1] */
+	uint hand;       /* next frame to examine */
+	uint filled;     /* frames loaded so far */
+} clock_state_t;
+
+static void *fault_clock_init(sim_t *sim) {
+	clock_state_t *s = (clock_state_t*)calloc(1, sizeof(clock_state_t));
+	uint n = sim->opts.phys_pages;
+	assert(s);
+	s->words = (n + CLOCK_WORD_BITS - 1) / CLOCK_WORD_BITS;
+	s->ref = (unsigned long long*)calloc(s->words, sizeof(unsigned long long));
+	assert(s->ref);
+	s->last_mask = ~0ULL >> (s->words * CLOCK_WORD_BITS - n);
+	return s;
+}
 
+static void fault_clock_fini(void *state) {
+	clock_state_t *s = (clock_state_t*)state;
+	free(s->ref);
+	free(s);
+}
 
-// LRU replacement 
-void fault_lru(pte_t *pte, ref_kind_t type) {
-	//printf("LRU not implemented yet!\n");
+/* Advance the hand to the first frame with a clear reference bit,
+ * clearing the bits on the way, and return that frame. */
+static uint clock_sweep(clock_state_t *s, uint n) {
+	unsigned long long mask, clear;
+	uint w = s->hand / CLOCK_WORD_BITS;
+	uint victim;
+
+	mask = ~0ULL << (s->hand % CLOCK_WORD_BITS);
+	while (1) {
+		if (w == s->words - 1)
+			mask &= s->last_mask;
+		clear = ~s->ref[w] & mask;
+		if (clear) {
+			victim = first_set(clear);
+			/* only the bits the hand passed, [hand, victim) */
+			s->ref[w] &= ~(mask & ((1ULL << victim) - 1));
+			victim += w * CLOCK_WORD_BITS;
+			s->hand = victim + 1 == n ? 0 : victim + 1;
+			return victim;
+		}
+		s->ref[w] &= ~mask;
+		if (++w == s->words)
+			w = 0;
+		mask = ~0ULL;
+	}
+}
 
-	static int frame = 0;
+static void fault_clock(sim_t *sim, pte_t *pte, ref_kind_t type) {
+	clock_state_t *s = (clock_state_t*)sim->fault_state;
+	uint pfn;
 
-	int i,location=0;
+	if (s->filled < sim->opts.phys_pages) {
+		pfn = s->filled++;
+	} else {
+		pfn = clock_sweep(s, sim->opts.phys_pages);
+		physmem_evict(sim, pfn, type);
+	}
+	physmem_load(sim, pfn, pte, type);
+	s->ref[pfn / CLOCK_WORD_BITS] |= 1ULL << (pfn % CLOCK_WORD_BITS);
+}
 
-	
+static void fault_clock_hit(sim_t *sim, pte_t *pte, ref_kind_t type) {
+	clock_state_t *s = (clock_state_t*)sim->fault_state;
+	s->ref[pte->pfn / CLOCK_WORD_BITS] |= 1ULL << (pte->pfn % CLOCK_WORD_BITS);
+}
 
-	int minimum=0;
 
+//Second chance algorithm - A variant of FIFO
+// Frames are queued in load order in a circular buffer of pfns, each with a
+// reference bit. The victim is the oldest frame whose bit is clear; frames
+// found with the bit set are cleared and requeued at the tail. physmem[] is
+// never reordered, so pfns keep matching their slots.
+typedef struct _second_state {
+	uint *queue;     /* pfns, oldest at queue[head] */
+	byte_t *chance;  /* reference bit per pfn */
+	uint head;
+	uint size;
+} second_state_t;
+
+static void *fault_second_init(sim_t *sim)
+{
+	second_state_t *s = (second_state_t*)calloc(1, sizeof(second_state_t));
+	assert(s);
+	s->queue = (uint*)malloc(sim->opts.phys_pages * sizeof(uint));
+	s->chance = (byte_t*)calloc(sim->opts.phys_pages, sizeof(byte_t));
+	assert(s->queue && s->chance);
+	return s;
+}
 
-	static int check = 1;
+static void fault_second_fini(void *state)
+{
+	second_state_t *s = (second_state_t*)state;
+	free(s->queue);
+	free(s->chance);
+	free(s);
+}
 
+static void fault_second(sim_t *sim, pte_t *pte, ref_kind_t type)
+{
+	second_state_t *s = (second_state_t*)sim->fault_state;
+	uint pfn;
 
-	if(check <= opts.phys_pages)
+	//Keep loading till all frames in memory are filled
+	if(s->size < sim->opts.phys_pages)
 	{
-		physmem_load(frame, pte, type);
-		frame = frame + 1;
-		check = check + 1;			
-
+		pfn = s->size;
+		s->queue[s->size++] = pfn;
 	}
 
 	else
 	{
-		
-		minimum = physmem[0]->counter;
-		for(i=0;i<opts.phys_pages;i++)
+		//The queue is full, so dequeueing the head and requeueing at
+		//the tail is just advancing head; pfns stay where they are.
+		while(s->chance[pfn = s->queue[s->head]])
 		{
-			if(minimum > physmem[i]->counter)
-			{
-				minimum = physmem[i]->counter;
-				location = i;
-			} 
+			s->chance[pfn] = 0;
+			if(++s->head == s->size)
+				s->head = 0;
 		}
+		if(++s->head == s->size)
+			s->head = 0;
+
+		physmem_evict(sim, pfn, type);
+	}
+
+	physmem_load(sim, pfn, pte, type);
+	s->chance[pfn] = 1;
+}
+
+static void fault_second_hit(sim_t *sim, pte_t *pte, ref_kind_t type)
+{
+	second_state_t *s = (second_state_t*)sim->fault_state;
+	s->chance[pte->pfn] = 1;
+}
 
-		physmem_evict(location, type);		
-		physmem_load(location, pte, type);
 
-	
+// ARC - Adaptive Replacement Cache (Megiddo and Modha, FAST '03)
+// Resident pages are split between T1, seen once recently, and T2, seen at
+// least twice. B1 and B2 remember pages recently evicted from each. A
+// fault on a page remembered in B1 means T1 was too small, so the target
+// size p of T1 grows; one in B2 shrinks it. The four lists are threaded
+// through pte_t's lru link and pte->queue says which one a page is on, so
+// the page table lookup doubles as the ARC directory and every step is
+// O(1). Ghosts are just non-resident pte_t, which the page table keeps
+// anyway.
+enum { ARC_NONE = 0, ARC_T1, ARC_T2, ARC_B1, ARC_B2 };
+
+typedef struct _arc_state {
+	list_t list[ARC_B2 + 1]; /* indexed by pte->queue; list[0] unused */
+	uint p;                  /* target size of T1 */
+} arc_state_t;
+
+static void *fault_arc_init(sim_t *sim) {
+	arc_state_t *s = (arc_state_t*)calloc(1, sizeof(arc_state_t));
+	int i;
+	assert(s);
+	for (i = 0; i <= ARC_B2; i++)
+		list_init(&s->list[i]);
+	return s;
+}
+
+static inline void arc_push(arc_state_t *s, pte_t *pte, int queue) {
+	list_push_front(&s->list[queue], &pte->lru);
+	pte->queue = queue;
+}
+
+static inline pte_t *arc_pop(arc_state_t *s, int queue) {
+	pte_t *pte = list_entry(list_pop_back(&s->list[queue]), pte_t, lru);
+	pte->queue = ARC_NONE;
+	return pte;
+}
 
+// Evict the LRU page of T1 or T2, as p dictates, into B1 or B2 and return
+// its frame. in_b2 is set if the faulting page was remembered in B2.
+static uint arc_replace(sim_t *sim, arc_state_t *s, bool_t in_b2,
+			ref_kind_t type) {
+	uint t1 = s->list[ARC_T1].size;
+	int from;
+	pte_t *victim;
+
+	if (t1 > 0 && ((in_b2 && t1 == s->p) || t1 > s->p ||
+		       list_empty(&s->list[ARC_T2])))
+		from = ARC_T1;
+	else
+		from = ARC_T2;
+	victim = arc_pop(s, from);
+	physmem_evict(sim, victim->pfn, type);
+	arc_push(s, victim, from == ARC_T1 ? ARC_B1 : ARC_B2);
+	return victim->pfn;
+}
+
+static void fault_arc(sim_t *sim, pte_t *pte, ref_kind_t type) {
+	arc_state_t *s = (arc_state_t*)sim->fault_state;
+	list_t *l = s->list;
+	uint c = sim->opts.phys_pages;
+	uint b1 = l[ARC_B1].size, b2 = l[ARC_B2].size, delta, pfn;
+	int queue = ARC_T2;
+
+	switch (pte->queue) {
+	case ARC_B1:
+		delta = b1 >= b2 ? 1 : b2 / b1;
+		s->p = s->p + delta < c ? s->p + delta : c;
+		list_remove(&l[ARC_B1], &pte->lru);
+		pfn = arc_replace(sim, s, FALSE, type);
+		break;
+	case ARC_B2:
+		delta = b2 >= b1 ? 1 : b1 / b2;
+		s->p = s->p > delta ? s->p - delta : 0;
+		list_remove(&l[ARC_B2], &pte->lru);
+		pfn = arc_replace(sim, s, TRUE, type);
+		break;
+	default:
+		queue = ARC_T1;
+		if (l[ARC_T1].size + b1 == c) {
+			if (l[ARC_T1].size < c) {
+				arc_pop(s, ARC_B1);
+				pfn = arc_replace(sim, s, FALSE, type);
+			} else {
+				/* B1 is empty: drop T1's LRU page entirely */
+				pfn = arc_pop(s, ARC_T1)->pfn;
+				physmem_evict(sim, pfn, type);
+			}
+		} else if (l[ARC_T1].size + l[ARC_T2].size == c) {
+			if (l[ARC_T1].size + l[ARC_T2].size + b1 + b2 == 2 * c)
+				arc_pop(s, ARC_B2);
+			pfn = arc_replace(sim, s, FALSE, type);
+		} else {
+			/* Memory is not full yet */
+			pfn = l[ARC_T1].size + l[ARC_T2].size;
+		}
 	}
 
+	physmem_load(sim, pfn, pte, type);
+	arc_push(s, pte, queue);
+}
+
+static void fault_arc_hit(sim_t *sim, pte_t *pte, ref_kind_t type) {
+	arc_state_t *s = (arc_state_t*)sim->fault_state;
 
+	list_remove(&s->list[pte->queue], &pte->lru);
+	arc_push(s, pte, ARC_T2);
 }
 
 
-// FIFO replacement 
-void fault_fifo(pte_t *pte, ref_kind_t type) {
-	//printf("FIFO not implemented yet!\n");
+// LIRS - Low Inter-reference Recency Set (Jiang and Zhang, SIGMETRICS '02)
+// Pages with a short reuse distance are LIR and always resident; the rest
+// are HIR, and only a few frames (about 1%) hold resident HIR pages. The
+// recency stack S (pte->lru, top first) holds every LIR page plus the HIR
+// pages referenced more recently than the oldest LIR page, and its bottom
+// is always LIR. Resident HIR pages also sit on the queue Q (pte->aux) and
+// are evicted from its front. An HIR page referenced again while still in
+// S has a shorter reuse distance than the bottom LIR page and swaps
+// status with it.
+// Evicted pages still in S are ghosts. They are kept on their own FIFO
+// (pte->aux again; a ghost is never on Q) and at most phys_pages of them
+// are remembered, so the metadata stays proportional to memory however
+// long the trace is. Pruning S is amortized O(1): each entry is pruned at
+// most once per push.
+#define LIRS_LIR   0x1
+#define LIRS_IN_S  0x2
+#define LIRS_IN_Q  0x4
+#define LIRS_GHOST 0x8
+
+typedef struct _lirs_state {
+	list_t s;       /* recency stack, most recent first */
+	list_t q;       /* resident HIR pages, next victim first */
+	list_t ghosts;  /* non-resident HIR pages in S, oldest first */
+	uint lir;       /* number of LIR pages */
+	uint lir_max;   /* frames for LIR pages; the rest hold HIR pages */
+} lirs_state_t;
+
+static void *fault_lirs_init(sim_t *sim) {
+	lirs_state_t *s = (lirs_state_t*)calloc(1, sizeof(lirs_state_t));
+	uint hir = sim->opts.phys_pages / 100;
+	assert(s);
+	list_init(&s->s);
+	list_init(&s->q);
+	list_init(&s->ghosts);
+	s->lir_max = sim->opts.phys_pages - (hir ? hir : 1);
+	return s;
+}
 
-	
-	int i,loc=0,min;
-	static int frame = 0;
-	static int check = 1;
+static inline void lirs_push_s(lirs_state_t *s, pte_t *pte) {
+	if (pte->queue & LIRS_IN_S) {
+		list_move_front(&s->s, &pte->lru);
+	} else {
+		list_push_front(&s->s, &pte->lru);
+		pte->queue |= LIRS_IN_S;
+	}
+}
 
-	if(check <= opts.phys_pages)
-	{
-		physmem_load(frame, pte, type);
-		frame = frame + 1;
-		check = check + 1;
-					
+static inline void lirs_remove_s(lirs_state_t *s, pte_t *pte) {
+	list_remove(&s->s, &pte->lru);
+	pte->queue &= ~LIRS_IN_S;
+}
+
+static inline void lirs_push_q(lirs_state_t *s, pte_t *pte) {
+	list_push_back(&s->q, &pte->aux);
+	pte->queue |= LIRS_IN_Q;
+}
 
+static inline void lirs_remove_q(lirs_state_t *s, pte_t *pte) {
+	list_remove(&s->q, &pte->aux);
+	pte->queue &= ~LIRS_IN_Q;
+}
+
+static inline void lirs_forget_ghost(lirs_state_t *s, pte_t *pte) {
+	list_remove(&s->ghosts, &pte->aux);
+	pte->queue &= ~LIRS_GHOST;
+}
+
+// Pop HIR pages off the bottom of S until it is LIR again.
+static void lirs_prune(lirs_state_t *s) {
+	pte_t *pte;
+
+	while (!list_empty(&s->s)) {
+		pte = list_entry(list_back(&s->s), pte_t, lru);
+		if (pte->queue & LIRS_LIR)
+			break;
+		lirs_remove_s(s, pte);
+		if (pte->queue & LIRS_GHOST)
+			lirs_forget_ghost(s, pte);
 	}
+}
 
-	else
-	{
+// The bottom LIR page becomes a resident HIR page, making room for a new
+// LIR page.
+static void lirs_demote_bottom(lirs_state_t *s) {
+	pte_t *pte = list_entry(list_back(&s->s), pte_t, lru);
 
-	min = physmem[0]->c;
-	for(i = 0;i<opts.phys_pages;i++)
-	{
+	pte->queue &= ~LIRS_LIR;
+	s->lir--;
+	lirs_remove_s(s, pte);
+	lirs_push_q(s, pte);
+	lirs_prune(s);
+}
 
-		if(physmem[i]->c < min)
-		{
-			min = physmem[i]->c;
-			loc = i;	
+static void fault_lirs(sim_t *sim, pte_t *pte, ref_kind_t type) {
+	lirs_state_t *s = (lirs_state_t*)sim->fault_state;
+	pte_t *victim;
+	uint pfn;
+
+	if (s->lir + s->q.size < sim->opts.phys_pages) {
+		/* Memory is not full yet; the first pages become LIR */
+		pfn = s->lir + s->q.size;
+		if (s->lir < s->lir_max) {
+			physmem_load(sim, pfn, pte, type);
+			pte->queue |= LIRS_LIR;
+			s->lir++;
+			lirs_push_s(s, pte);
+			return;
+		}
+	} else {
+		victim = list_entry(list_front(&s->q), pte_t, aux);
+		lirs_remove_q(s, victim);
+		pfn = victim->pfn;
+		physmem_evict(sim, pfn, type);
+		if (victim->queue & LIRS_IN_S) {
+			list_push_back(&s->ghosts, &victim->aux);
+			victim->queue |= LIRS_GHOST;
+			if (s->ghosts.size > sim->opts.phys_pages) {
+				victim = list_entry(list_front(&s->ghosts), pte_t, aux);
+				lirs_forget_ghost(s, victim);
+				lirs_remove_s(s, victim);
+			}
 		}
+	}
+
+	physmem_load(sim, pfn, pte, type);
+	if (pte->queue & LIRS_GHOST) {
+		/* Reused within S: its reuse distance beats the bottom LIR's */
+		lirs_forget_ghost(s, pte);
+		lirs_push_s(s, pte);
+		pte->queue |= LIRS_LIR;
+		s->lir++;
+		lirs_demote_bottom(s);
+	} else {
+		lirs_push_s(s, pte);
+		lirs_push_q(s, pte);
+	}
+}
 
+static void fault_lirs_hit(sim_t *sim, pte_t *pte, ref_kind_t type) {
+	lirs_state_t *s = (lirs_state_t*)sim->fault_state;
+	bool_t bottom;
+
+	if (pte->queue & LIRS_LIR) {
+		bottom = list_back(&s->s) == &pte->lru;
+		lirs_push_s(s, pte);
+		if (bottom)
+			lirs_prune(s);
+	} else if (pte->queue & LIRS_IN_S) {
+		lirs_push_s(s, pte);
+		lirs_remove_q(s, pte);
+		pte->queue |= LIRS_LIR;
+		s->lir++;
+		lirs_demote_bottom(s);
+	} else {
+		lirs_push_s(s, pte);
+		lirs_remove_q(s, pte);
+		lirs_push_q(s, pte);
 	}
+}
 
-	physmem_evict(loc, type);		
-	physmem_load(loc, pte, type);
 
-	
+// CLOCK-Pro (Jiang, Chen and Zhang, USENIX '05)
+// CLOCK's approximation of LIRS. Every page is on one ring (pte->lru) and
+// is hot, resident cold, or a non-resident cold page still in its test
+// period ("test"). Three hands sweep the ring:
+//  - the cold hand evicts unreferenced cold pages, which stay on the ring
+//    as test pages, and promotes referenced ones to hot;
+//  - the hot hand demotes unreferenced hot pages to cold, keeping the hot
+//    pages to phys_pages - cold_target;
+//  - the test hand ends test periods, dropping test pages from the ring.
+// A fault on a test page means cold pages deserve more room, so
+// cold_target grows; a test period that ends unused shrinks it. As in
+// widely used implementations, every resident cold page is taken to be in
+// its test period. At most phys_pages test pages are kept.
+#define CP_HOT  0x1
+#define CP_COLD 0x2
+#define CP_TEST 0x4
+#define CP_REF  0x8
+
+typedef struct _clockpro_state {
+	list_t ring;
+	list_node_t *hand_hot, *hand_cold, *hand_test;
+	uint hot, cold, test; /* pages of each kind on the ring */
+	uint cold_target;     /* resident cold pages wanted, 1..phys_pages */
+	uint *free;           /* frames not holding a page */
+	uint num_free;
+} clockpro_state_t;
+
+static void *fault_clockpro_init(sim_t *sim) {
+	clockpro_state_t *s = (clockpro_state_t*)calloc(1, sizeof(clockpro_state_t));
+	uint i;
+	assert(s);
+	list_init(&s->ring);
+	/* start like LIRS, with about 1% of memory for cold pages */
+	s->cold_target = sim->opts.phys_pages / 100;
+	if (s->cold_target == 0)
+		s->cold_target = 1;
+	s->free = (uint*)malloc(sim->opts.phys_pages * sizeof(uint));
+	assert(s->free);
+	/* hand out frame 0 first */
+	for (i = 0; i < sim->opts.phys_pages; i++)
+		s->free[i] = sim->opts.phys_pages - 1 - i;
+	s->num_free = sim->opts.phys_pages;
+	return s;
+}
 
+static void fault_clockpro_fini(void *state) {
+	clockpro_state_t *s = (clockpro_state_t*)state;
+	free(s->free);
+	free(s);
 }
+
+#define clockpro_entry(node) list_entry(node, pte_t, lru)
+
+static void clockpro_insert(clockpro_state_t *s, pte_t *pte) {
+	if (s->hand_hot == NULL) {
+		list_push_back(&s->ring, &pte->lru);
+		s->hand_hot = s->hand_cold = s->hand_test = &pte->lru;
+	} else {
+		/* the newest position: the last the hot hand reaches */
+		list_insert_before(&s->ring, s->hand_hot, &pte->lru);
+	}
 }
 
-//Clock replacement algorithm
-static void fault_clock(pte_t *pte, ref_kind_t type) {
+static void clockpro_remove(clockpro_state_t *s, pte_t *pte) {
+	list_node_t *node = &pte->lru;
+	list_node_t *next = s->ring.size > 1 ? list_ring_next(&s->ring, node) : NULL;
+
+	if (s->hand_hot == node)
+		s->hand_hot = next;
+	if (s->hand_cold == node)
+		s->hand_cold = next;
+	if (s->hand_test == node)
+		s->hand_test = next;
+	list_remove(&s->ring, node);
+}
 
-	static int check = 1;
-	static int frame = 0;
-	int i,loc=0;
-	static int clock_hand = 0;
+static void clockpro_run_test(clockpro_state_t *s) {
+	pte_t *pte = clockpro_entry(s->hand_test);
+
+	if (pte->queue & CP_TEST) {
+		clockpro_remove(s, pte); /* moves the hand on */
+		pte->queue = 0;
+		s->test--;
+		if (s->cold_target > 1)
+			s->cold_target--;
+	} else {
+		s->hand_test = list_ring_next(&s->ring, s->hand_test);
+	}
+}
 
-	if(check <= opts.phys_pages)
-	{
-		physmem_load(frame, pte, type);
-		physmem[frame]->used = 1;
-		frame = frame + 1;
-		check = check + 1;
-					
+static void clockpro_run_hot(clockpro_state_t *s) {
+	pte_t *pte;
+
+	if (s->hand_hot == s->hand_test)
+		clockpro_run_test(s);
+	pte = clockpro_entry(s->hand_hot);
+	if (pte->queue & CP_HOT) {
+		if (pte->queue & CP_REF) {
+			pte->queue &= ~CP_REF;
+		} else {
+			pte->queue = CP_COLD;
+			s->hot--;
+			s->cold++;
+		}
+	}
+	s->hand_hot = list_ring_next(&s->ring, s->hand_hot);
+}
+
+static void clockpro_run_cold(sim_t *sim, clockpro_state_t *s,
+			      ref_kind_t type) {
+	pte_t *pte = clockpro_entry(s->hand_cold);
+	uint c = sim->opts.phys_pages;
+
+	s->hand_cold = list_ring_next(&s->ring, s->hand_cold);
+	if (pte->queue & CP_COLD) {
+		if (pte->queue & CP_REF) {
+			pte->queue = CP_HOT;
+			s->cold--;
+			s->hot++;
+		} else {
+			s->free[s->num_free++] = pte->pfn;
+			physmem_evict(sim, pte->pfn, type);
+			pte->queue = CP_TEST;
+			s->cold--;
+			s->test++;
+			while (s->test > c)
+				clockpro_run_test(s);
+		}
+	}
+	while (s->hot > c - s->cold_target)
+		clockpro_run_hot(s);
+}
 
+static void fault_clockpro(sim_t *sim, pte_t *pte, ref_kind_t type) {
+	clockpro_state_t *s = (clockpro_state_t*)sim->fault_state;
+	int kind = CP_COLD;
+
+	if (pte->queue & CP_TEST) {
+		/* Faulted in its test period: it should have been kept */
+		if (s->cold_target < sim->opts.phys_pages)
+			s->cold_target++;
+		clockpro_remove(s, pte);
+		s->test--;
+		kind = CP_HOT;
 	}
+	while (s->hot + s->cold >= sim->opts.phys_pages)
+		clockpro_run_cold(sim, s, type);
 
+	physmem_load(sim, s->free[--s->num_free], pte, type);
+	pte->queue = kind;
+	if (kind == CP_HOT)
+		s->hot++;
 	else
-	{
-		for(i=clock_hand;i<opts.phys_pages;i++)
-		{
-			if(physmem[i]->used == 0)
-			{
-				loc = i;
-				break;
-			}
-			
-			else
-			{
-				physmem[i]->used = 0;
-			}
+		s->cold++;
+	clockpro_insert(s, pte);
+}
+
+static void fault_clockpro_hit(sim_t *sim, pte_t *pte, ref_kind_t type) {
+	pte->queue |= CP_REF;
+}
 
-			if((i+1) == opts.phys_pages )
-				i = -1;	
 
+// WSClock (Carr and Hennessy, SOSP '81)
+// A clock over the frames that only takes a page once it has left the
+// working set: its last use, pte->counter in references, is at least
+// -w WINDOW references ago. The hand stops at the first such page and
+// rests after it. When every page is in the working set, memory is
+// smaller than it and the page used longest ago goes instead. Resident
+// pages are also kept on a recency list, as lru keeps them, so that case
+// is seen and its victim found at the back of the list without a lap.
+typedef struct _wsclock_state {
+	list_t lru;     /* resident pages, most recently used first */
+	uint hand;
+	uint filled;
+} wsclock_state_t;
+
+static void *fault_wsclock_init(sim_t *sim) {
+	wsclock_state_t *s = (wsclock_state_t*)calloc(1, sizeof(wsclock_state_t));
+	assert(s);
+	list_init(&s->lru);
+	return s;
+}
 
+static void fault_wsclock(sim_t *sim, pte_t *pte, ref_kind_t type) {
+	wsclock_state_t *s = (wsclock_state_t*)sim->fault_state;
+	const int *last_use = sim->frametab.last_use;
+	uint n = sim->opts.phys_pages;
+	int start = sim->ref_counter - (int)sim->opts.ws_window;
+	pte_t *oldest;
+	uint pfn;
+
+	if (s->filled < n) {
+		pfn = s->filled++;
+	} else {
+		oldest = list_entry(list_back(&s->lru), pte_t, lru);
+		if (last_use[oldest->pfn] > start) {
+			pfn = oldest->pfn;
+		} else {
+			/* The lap from the hand is [hand, n) then [0, hand).
+			 * It stops at the oldest page if not before. */
+			pfn = physmem_first_le(last_use, s->hand, n, start);
+			if (pfn == n) {
+				pfn = physmem_first_le(last_use, 0, s->hand, start);
+				assert(pfn < s->hand);
+			}
 		}
+		list_remove(&s->lru, &sim->physmem[pfn]->lru);
+		s->hand = pfn + 1 == n ? 0 : pfn + 1;
+		physmem_evict(sim, pfn, type);
+	}
+	physmem_load(sim, pfn, pte, type);
+	list_push_front(&s->lru, &pte->lru);
+}
+
+static void fault_wsclock_hit(sim_t *sim, pte_t *pte, ref_kind_t type) {
+	list_move_front(&((wsclock_state_t*)sim->fault_state)->lru, &pte->lru);
+}
+
+
+// Enhanced clock, the (referenced, modified) clock
+// Frames fall into four classes by their R and M bits, and the hand takes
+// the first frame of the lowest class it can find: a lap looking for
+// (0,0) that changes nothing, then a lap looking for (0,1) that clears
+// the R bits it passes, then both again if need be, which must succeed.
+// Clean pages are preferred because evicting them costs no write; with
+// the flusher (-F) cleaning pages in the background there are more of
+// them. M is the frame table's copy of pte->modified, which the flusher
+// clears.
+typedef struct _eclock_state {
+	byte_t *ref;     /* R bit per pfn */
+	uint hand;
+	uint filled;
+} eclock_state_t;
+
+static void *fault_eclock_init(sim_t *sim) {
+	eclock_state_t *s = (eclock_state_t*)calloc(1, sizeof(eclock_state_t));
+	assert(s);
+	s->ref = (byte_t*)calloc(sim->opts.phys_pages, sizeof(byte_t));
+	assert(s->ref);
+	return s;
+}
 
-				
-		physmem_evict(loc, type);  
-		physmem_load(loc, pte, type);
+static void fault_eclock_fini(void *state) {
+	eclock_state_t *s = (eclock_state_t*)state;
+	free(s->ref);
+	free(s);
+}
 
-		clock_hand++;
+/* The first frame of class (0, dirty) in a lap from the hand, or n. A
+ * lap for dirty frames clears the R bits it passes. */
+static uint eclock_lap(sim_t *sim, eclock_state_t *s, byte_t dirty) {
+	const byte_t *modified = sim->frametab.dirty;
+	uint n = sim->opts.phys_pages;
+	uint pfn;
+
+	pfn = physmem_first_clear(s->ref, modified, s->hand, n, dirty);
+	if (dirty)
+		memset(s->ref + s->hand, 0, pfn - s->hand);
+	if (pfn < n || s->hand == 0)
+		return pfn;
+	pfn = physmem_first_clear(s->ref, modified, 0, s->hand, dirty);
+	if (dirty)
+		memset(s->ref, 0, pfn);
+	return pfn < s->hand ? pfn : n;
+}
 
-		if(clock_hand == opts.phys_pages)
-			clock_hand = 0;
-		
+/* Find the victim; the caller moves the hand past it. */
+static uint eclock_sweep(sim_t *sim, eclock_state_t *s) {
+	uint n = sim->opts.phys_pages;
+	uint pfn;
 
-		
-		
+	while (1) {
+		if ((pfn = eclock_lap(sim, s, 0)) < n)
+			return pfn;
+		if ((pfn = eclock_lap(sim, s, 1)) < n)
+			return pfn;
 	}
+}
+
+static void fault_eclock(sim_t *sim, pte_t *pte, ref_kind_t type) {
+	eclock_state_t *s = (eclock_state_t*)sim->fault_state;
+	uint pfn;
 
+	if (s->filled < sim->opts.phys_pages) {
+		pfn = s->filled++;
+	} else {
+		pfn = eclock_sweep(sim, s);
+		s->hand = pfn + 1 == sim->opts.phys_pages ? 0 : pfn + 1;
+		physmem_evict(sim, pfn, type);
+	}
+	physmem_load(sim, pfn, pte, type);
+	s->ref[pfn] = 1;
+}
 
+static void fault_eclock_hit(sim_t *sim, pte_t *pte, ref_kind_t type) {
+	eclock_state_t *s = (eclock_state_t*)sim->fault_state;
+	s->ref[pte->pfn] = 1;
 }
 
 
-//Second chance algorithm - A variant of FIFO
-static void fault_second(pte_t *pte, ref_kind_t type)
-{
+// OPT - Belady's optimal replacement, the bound for every other handler
+// Evicts the page whose next reference is farthest in the future, using
+// the next-use index built before replay (see opt.h). Resident frames sit
+// in an indexed heap keyed so the farthest next use is on top; pages
+// never referenced again come first, lowest frame first. A hit moves the
+// page's key to its new next use, so both hits and faults are O(log n).
+typedef struct _opt_state {
+	heap_t heap;
+} opt_state_t;
+
+static void *fault_opt_init(sim_t *sim) {
+	opt_state_t *s = (opt_state_t*)calloc(1, sizeof(opt_state_t));
+	assert(s);
+	heap_init(&s->heap, sim->opts.phys_pages);
+	return s;
+}
 
+static void fault_opt_fini(void *state) {
+	opt_state_t *s = (opt_state_t*)state;
+	heap_free(&s->heap);
+	free(s);
+}
 
-	//printf("\n\nSecond clock algorithm not implemented yet\n\n");
-	static int check = 1;
-	static int frame = 0;
-	int i,j;
-	int loc = 0;
-	//int loc2=0,min=0;
+static inline heap_key_t opt_key(pte_t *pte) {
+	return (heap_key_t)(OPT_NEVER - pte->next_ref) << 32 | pte->pfn;
+}
 
-	//pte_t *temp =(pte_t *)malloc(sizeof(pte_t));
-	pte_t *temp;
-	//Keep loading till all frames in memory are filled
-	if(check <= opts.phys_pages)
-	{
-		physmem_load(frame, pte, type);
-		frame = frame + 1;
-		check = check + 1;
-					
+static void fault_opt(sim_t *sim, pte_t *pte, ref_kind_t type) {
+	opt_state_t *s = (opt_state_t*)sim->fault_state;
+	uint pfn;
 
+	assert(sim->opt_next);
+	if (s->heap.size < sim->opts.phys_pages) {
+		pfn = s->heap.size;
+	} else {
+		pfn = heap_pop(&s->heap);
+		physmem_evict(sim, pfn, type);
 	}
+	physmem_load(sim, pfn, pte, type);
+	heap_push(&s->heap, pfn, opt_key(pte));
+}
 
-	//Finding the minimum
-	
+static void fault_opt_hit(sim_t *sim, pte_t *pte, ref_kind_t type) {
+	opt_state_t *s = (opt_state_t*)sim->fault_state;
+	heap_update(&s->heap, pte->pfn, opt_key(pte));
+}
 
-	else
-	{
-		for(i=0;i<opts.phys_pages;i++)
-		{
-			for(j=0;j<(opts.phys_pages-i-1);j++)
-			{
-				if(physmem[j+1]->c < physmem[j]->c)
-				{
-					temp = physmem[j];
-					physmem[j] = physmem[j+1];
-					physmem[j+1] = temp;
-				}
-			}
-		}
 
-		
-		for(i=0;i<opts.phys_pages;i++)
-		{
-			if(physmem[i]->chance == 1)
-			{
-				physmem[i]->chance = 0;
- 
-			}
+// Sampled LRU, as Redis approximates LRU eviction
+// A fault samples -k SAMPLES frames at random and evicts the one used
+// longest ago, reading last-use times from the frame table; a hit costs
+// nothing beyond what sim_reference already records. With a pool (-k
+// SAMPLES:POOL) the oldest candidates seen are kept between faults, newest
+// first, and the victim is the oldest one that has not been used or
+// replaced since it was sampled, so each fault effectively sees more
+// than SAMPLES frames.
+typedef struct _sampled_entry {
+	uint pfn;
+	int last_use;   /* when sampled */
+} sampled_entry_t;
+
+typedef struct _sampled_state {
+	rng_t rng;
+	uint filled;
+	sampled_entry_t *pool;
+	uint pool_size;
+} sampled_state_t;
+
+static void *fault_sampled_init(sim_t *sim) {
+	sampled_state_t *s = (sampled_state_t*)calloc(1, sizeof(sampled_state_t));
+	assert(s);
+	rng_seed(&s->rng, sim->opts.seed, RNG_STREAM_SAMPLED);
+	if (sim->opts.sample_pool) {
+		s->pool = (sampled_entry_t*)calloc(sim->opts.sample_pool,
+						   sizeof(sampled_entry_t));
+		assert(s->pool);
+	}
+	return s;
+}
 
-			else 
-			{
-				loc = i;
-				break;
-			}
+static void fault_sampled_fini(void *state) {
+	sampled_state_t *s = (sampled_state_t*)state;
+	free(s->pool);
+	free(s);
+}
 
+/* Offer frame pfn, last used at last_use, to the pool. */
+static void sampled_pool_offer(sim_t *sim, sampled_state_t *s, uint pfn,
+			       int last_use) {
+	sampled_entry_t *pool = s->pool;
+	uint i;
+
+	for (i = 0; i < s->pool_size && pool[i].pfn != pfn; i++)
+		;
+	if (i < s->pool_size) {
+		/* Sampled again; it may have been used since. */
+		memmove(pool + i, pool + i + 1,
+			(s->pool_size - i - 1) * sizeof(sampled_entry_t));
+		s->pool_size--;
+	}
+	if (s->pool_size == sim->opts.sample_pool) {
+		if (last_use >= pool[0].last_use)
+			return;
+		memmove(pool, pool + 1, --s->pool_size * sizeof(sampled_entry_t));
+	}
+	for (i = s->pool_size; i > 0 && pool[i - 1].last_use < last_use; i--)
+		;
+	memmove(pool + i + 1, pool + i,
+		(s->pool_size - i) * sizeof(sampled_entry_t));
+	pool[i].pfn = pfn;
+	pool[i].last_use = last_use;
+	s->pool_size++;
+}
+
+static void fault_sampled(sim_t *sim, pte_t *pte, ref_kind_t type) {
+	sampled_state_t *s = (sampled_state_t*)sim->fault_state;
+	const int *last_use = sim->frametab.last_use;
+	uint n = sim->opts.phys_pages;
+	uint i, pfn, victim = 0;
+	sampled_entry_t *e;
+
+	if (s->filled < n) {
+		physmem_load(sim, s->filled++, pte, type);
+		return;
+	}
+	for (i = 0; i < sim->opts.sample_k; i++) {
+		pfn = rng_below(&s->rng, n);
+		if (i == 0 || last_use[pfn] < last_use[victim])
+			victim = pfn;
+		if (s->pool)
+			sampled_pool_offer(sim, s, pfn, last_use[pfn]);
+	}
+	while (s->pool_size > 0) {
+		e = &s->pool[--s->pool_size];
+		if (last_use[e->pfn] == e->last_use) {
+			victim = e->pfn;
+			break;
 		}
+	}
+	physmem_evict(sim, victim, type);
+	physmem_load(sim, victim, pte, type);
+}
 
-		
-		physmem_evict(loc, type);  
-		physmem_load(loc, pte, type);
 
+fault_handler_info_t *fault_lookup(const char *name) {
+	fault_handler_info_t *info;
+	for (info = fault_handlers; info->name != NULL; info++)
+		if (strcmp(info->name, name) == 0)
+			return info;
+	assert(0);
+	return NULL;
+}
 
+/* clock_sweep in frames frames against the textbook clock, a frame at a
+ * time, from random hands over random reference bits, most of them set
+ * and every eighth time all of them so the hand goes all the way round. */
+static void fault_test_clock(uint frames) {
+	opts_t config;
+	clock_state_t *s;
+	byte_t ref[256];
+	sim_t *sim;
+	rng_t rng;
+	uint hand, victim, i, trial;
+
+	assert(frames <= sizeof(ref));
+	sim_test_config(&config, "clock", frames);
+	sim = sim_new(&config);
+	s = (clock_state_t*)sim->fault_state;
+	rng_seed(&rng, frames, 15);
+	for (trial = 0; trial < 1000; trial++) {
+		memset(s->ref, 0, s->words * sizeof(s->ref[0]));
+		for (i = 0; i < frames; i++) {
+			ref[i] = trial % 8 == 0 || rng_below(&rng, 8) != 0;
+			s->ref[i / CLOCK_WORD_BITS] |=
+				(unsigned long long)ref[i] << (i % CLOCK_WORD_BITS);
+		}
+		/* Often in the partial last word, to wrap from it */
+		hand = rng_below(&rng, 2) ? frames - 1 - rng_below(&rng, 4) :
+			rng_below(&rng, frames);
+		s->hand = hand;
+
+		for (; ref[hand]; hand = (hand + 1) % frames)
+			ref[hand] = 0;
+		victim = hand;
+		hand = (hand + 1) % frames;
+
+		assert(clock_sweep(s, frames) == victim && s->hand == hand);
+		for (i = 0; i < frames; i++)
+			assert((s->ref[i / CLOCK_WORD_BITS] >>
+				(i % CLOCK_WORD_BITS) & 1) == ref[i]);
+		assert((s->ref[s->words - 1] & ~s->last_mask) == 0);
 	}
+	sim_free(sim);
+}
 
+/* Faults of handler name over pages[] in frames frames, with a -w window
+ * of window references. */
+static count_t fault_test_pages(const char *name, uint frames, uint window,
+				const int *pages, int count) {
+	opts_t config;
+	sim_t *sim;
+	count_t faults;
+
+	sim_test_config(&config, name, frames);
+	config.ws_window = window;
+	sim = sim_new(&config);
+	sim_test_pages(sim, pages, count);
+	faults = stats_total(sim->stats->miss);
+	sim_free(sim);
+	return faults;
+}
+
+/* Reference pages[] as kinds[] under eclock with one frame per page, set
+ * the frames' R bits to ref[] with the hand at frame 0, then fault in
+ * page 9. */
+static sim_t *fault_test_eclock(const int *pages, const char *kinds,
+				int count, const byte_t *ref) {
+	opts_t config;
+	eclock_state_t *s;
+	sim_t *sim;
+	int fault = 9;
+
+	sim_test_config(&config, "eclock", count);
+	sim = sim_new(&config);
+	sim_test_refs(sim, pages, kinds, count);
+	s = (eclock_state_t*)sim->fault_state;
+	assert(s->hand == 0);
+	memcpy(s->ref, ref, count);
+	sim_test_pages(sim, &fault, 1);
+	return sim;
+}
 
+/* Reference two pages twice each, scan a run of pages used only once,
+ * then touch the first two again. Returns the faults of that last step. */
+static count_t fault_test_scan(const char *name) {
+	opts_t config;
+	trace_ref_t ref = { 1, REF_KIND_LOAD, 0 };
+	sim_t *sim;
+	count_t faults;
+	int i;
+
+	sim_test_config(&config, name, 4);
+	sim = sim_new(&config);
+	for (i = 0; i < 4; i++) {
+		ref.vaddr = (i % 2) * 16;
+		sim_reference(sim, &ref);
+	}
+	for (i = 10; i < 50; i++) {
+		ref.vaddr = i * 16;
+		sim_reference(sim, &ref);
+	}
+	faults = stats_total(sim->stats->miss);
+	for (i = 0; i < 2; i++) {
+		ref.vaddr = i * 16;
+		sim_reference(sim, &ref);
+	}
+	faults = stats_total(sim->stats->miss) - faults;
+	sim_free(sim);
+	return faults;
 }
 
+/* Faults of handler name, with k samples and a pool and seeded by seed,
+ * over 500 random references in 6 frames, three in four to a hot set of
+ * 4 pages and the rest to 28 others. */
+static count_t fault_test_hot(const char *name, uint k, uint pool,
+			      unsigned long long seed) {
+	opts_t config;
+	trace_ref_t ref = { 1, REF_KIND_LOAD, 0 };
+	rng_t rng;
+	sim_t *sim;
+	count_t faults;
+	int i;
 
+	sim_test_config(&config, name, 6);
+	config.sample_k = k;
+	config.sample_pool = pool;
+	config.seed = seed;
+	sim = sim_new(&config);
+	rng_seed(&rng, 7, 7);
+	for (i = 0; i < 500; i++) {
+		ref.vaddr = (rng_below(&rng, 4) ? rng_below(&rng, 4) :
+			     4 + rng_below(&rng, 28)) * 16;
+		sim_reference(sim, &ref);
+	}
+	faults = stats_total(sim->stats->miss);
+	sim_free(sim);
+	return faults;
+}
 
+void fault_test() {
+	/* 3 is loaded with every page in the window, so the least recently
+	 * used, 1, makes way rather than 0 at the hand. */
+	static const int all_in[] = { 0, 1, 2, 0, 3, 0, 2, 1 };
+	/* With a window of 2, 3 takes 0, the first page from the hand to
+	 * have left the working set, rather than the older 2. */
+	static const int lap[] = { 0, 1, 2, 0, 1, 3, 2, 0 };
+	static const int four[] = { 0, 1, 2, 3 };
+	/* When 2 comes back, all three resident pages are referenced.
+	 * Requeued at the tail as they are cleared, they come round again
+	 * and 3 goes. Kept in place, 1 is ahead of 3 and goes instead, only
+	 * to fault straight back in: 7 faults rather than 6. */
+	static const int requeue[] = { 0, 1, 2, 3, 1, 0, 1, 2, 1 };
+	static const byte_t unused[] = { 0, 0, 0 }, third[] = { 1, 1, 0, 1 };
+	eclock_state_t *s;
+	count_t lru, two;
+	sim_t *sim;
+
+	printf("Testing sampled lru\n");
+	/* Enough samples all but always include the least recently used
+	 * frame; fewer lose more of the hot set, and a pool helps. */
+	lru = fault_test_hot("lru", 0, 0, 1);
+	two = fault_test_hot("sampled-lru", 2, 0, 1);
+	assert(fault_test_hot("sampled-lru", 64, 0, 1) == lru);
+	assert(fault_test_hot("sampled-lru", 1, 0, 1) > two && two > lru);
+	assert(fault_test_hot("sampled-lru", 2, 6, 1) < two);
+
+	printf("Testing seeds\n");
+	assert(fault_test_hot("random", 0, 0, 5) ==
+	       fault_test_hot("random", 0, 0, 5));
+	assert(fault_test_hot("random", 0, 0, 5) !=
+	       fault_test_hot("random", 0, 0, 6));
+
+	printf("Testing scan resistance\n");
+	/* LRU loses the frequently used pages to the scan; the others keep
+	 * them */
+	assert(fault_test_scan("lru") == 2);
+	assert(fault_test_scan("arc") == 0);
+	assert(fault_test_scan("lirs") == 0);
+	assert(fault_test_scan("clockpro") == 0);
+
+	printf("Testing second chance\n");
+	assert(fault_test_pages("second", 3, 0, requeue, 9) == 6);
+
+	printf("Testing clock\n");
+	/* Neither a whole number of words: the last one is partial */
+	fault_test_clock(70);
+	fault_test_clock(130);
+
+	printf("Testing wsclock\n");
+	assert(fault_test_pages("wsclock", 3, 100, all_in, 8) == 5);
+	assert(fault_test_pages("wsclock", 3, 2, lap, 8) == 5);
+	assert(fault_test_pages("lru", 3, 0, lap, 8) == 6);
+
+	printf("Testing eclock\n");
+	/* 0 at the hand is (0,1) but 1 is (0,0): the clean page goes */
+	sim = fault_test_eclock(four, "WRR", 3, unused);
+	assert(sim->physmem[0]->vfn == 0 && sim->physmem[1]->vfn == 9);
+	assert(stats_total(sim->stats->evict_dirty) == 0);
+	sim_free(sim);
+	/* No (0,0) frame: the (0,1) lap takes 2, clearing the R bits it
+	 * passes on the way but not those after it */
+	sim = fault_test_eclock(four, "RRWR", 4, third);
+	s = (eclock_state_t*)sim->fault_state;
+	assert(sim->physmem[2]->vfn == 9);
+	assert(s->ref[0] == 0 && s->ref[1] == 0 && s->ref[3] == 1);
+	assert(stats_total(sim->stats->evict_dirty) == 1);
+	sim_free(sim);
+}
@@ -10,10 +10,22 @@
 #include <pagetable.h>
 
 /* fault handlers are functions that return nothing (void) and
- * take 2 arguments: a pte_t* and a ref_kind_t.
+ * take 3 arguments: the simulation, a pte_t* and a ref_kind_t.
  * The pte is the new page that must be inserted, and the
  * type is for statistical reporting. */
-typedef void (*fault_handler_t)(pte_t *pte, ref_kind_t type);
+typedef void (*fault_handler_t)(sim_t *sim, pte_t *pte, ref_kind_t type);
+
+/* hit handlers are called by sim_reference() on every reference to a page
+ * that is already in memory, letting an algorithm keep its bookkeeping
+ * up to date in O(1) instead of rescanning physmem on a fault.
+ * May be NULL if the algorithm does not care about hits. */
+typedef void (*fault_hit_t)(sim_t *sim, pte_t *pte, ref_kind_t type);
+
+/* init returns the handler's per-simulation state, which is kept in
+ * sim->fault_state; fini releases it. A NULL init means no state, a NULL
+ * fini that the state is released with free(). */
+typedef void *(*fault_init_t)(sim_t *sim);
+typedef void (*fault_fini_t)(void *state);
 
 /* fault_handler_info_t lets us match the actual function to a
  * name. fault_handlers is searched by options.c to locate the
@@ -21,11 +33,20 @@ typedef void (*fault_handler_t)(pte_t *pte, ref_kind_t type);
 typedef struct _fault_handler_info {
   char *name;
   fault_handler_t handler;
+  fault_hit_t hit;
+  fault_init_t init;
+  fault_fini_t fini;
 } fault_handler_info_t;
 
 extern fault_handler_info_t fault_handlers[];
 
-/* Initialize any state needed by this module. */
-void fault_init();
+/* The handler called name, which must exist. */
+fault_handler_info_t *fault_lookup(const char *name);
+
+/* Initialize any state needed by sim's fault handler. */
+void fault_init(sim_t *sim);
+void fault_free(sim_t *sim);
+
+void fault_test();
 
 #endif /* FAULT_H */
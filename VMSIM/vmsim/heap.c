@@ -0,0 +1,139 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <heap.h>
+
+static void heap_sift_up(heap_t *h, uint i);
+static void heap_sift_down(heap_t *h, uint i);
+
+void heap_init(heap_t *h, uint capacity) {
+  uint i;
+
+  h->items = (uint*)malloc(capacity * sizeof(uint));
+  h->pos = (uint*)malloc(capacity * sizeof(uint));
+  h->keys = (heap_key_t*)malloc(capacity * sizeof(heap_key_t));
+  assert(h->items && h->pos && h->keys);
+  for (i = 0; i < capacity; i++)
+    h->pos[i] = HEAP_NONE;
+  h->size = 0;
+  h->capacity = capacity;
+}
+
+void heap_free(heap_t *h) {
+  free(h->items);
+  free(h->pos);
+  free(h->keys);
+  h->items = h->pos = NULL;
+  h->keys = NULL;
+  h->size = h->capacity = 0;
+}
+
+static inline void heap_place(heap_t *h, uint i, uint id) {
+  h->items[i] = id;
+  h->pos[id] = i;
+}
+
+void heap_sift_up(heap_t *h, uint i) {
+  uint id = h->items[i];
+  heap_key_t key = h->keys[id];
+
+  while (i > 0) {
+    uint parent = (i - 1) / 2;
+    if (h->keys[h->items[parent]] <= key)
+      break;
+    heap_place(h, i, h->items[parent]);
+    i = parent;
+  }
+  heap_place(h, i, id);
+}
+
+void heap_sift_down(heap_t *h, uint i) {
+  uint id = h->items[i];
+  heap_key_t key = h->keys[id];
+
+  while (1) {
+    uint child = 2 * i + 1;
+    if (child >= h->size)
+      break;
+    if (child + 1 < h->size &&
+	h->keys[h->items[child + 1]] < h->keys[h->items[child]])
+      child++;
+    if (key <= h->keys[h->items[child]])
+      break;
+    heap_place(h, i, h->items[child]);
+    i = child;
+  }
+  heap_place(h, i, id);
+}
+
+void heap_push(heap_t *h, uint id, heap_key_t key) {
+  assert(id < h->capacity && !heap_contains(h, id));
+  h->keys[id] = key;
+  heap_place(h, h->size, id);
+  heap_sift_up(h, h->size++);
+}
+
+uint heap_pop(heap_t *h) {
+  uint id;
+  assert(h->size > 0);
+  id = h->items[0];
+  heap_remove(h, id);
+  return id;
+}
+
+void heap_remove(heap_t *h, uint id) {
+  uint i, last;
+
+  assert(heap_contains(h, id));
+  i = h->pos[id];
+  h->pos[id] = HEAP_NONE;
+  last = h->items[--h->size];
+  if (i == h->size)
+    return;
+  heap_place(h, i, last);
+  heap_sift_up(h, i);
+  heap_sift_down(h, h->pos[last]);
+}
+
+void heap_update(heap_t *h, uint id, heap_key_t key) {
+  heap_key_t old;
+
+  assert(heap_contains(h, id));
+  old = h->keys[id];
+  h->keys[id] = key;
+  if (key < old)
+    heap_sift_up(h, h->pos[id]);
+  else if (key > old)
+    heap_sift_down(h, h->pos[id]);
+}
+
+void heap_test() {
+  heap_t h;
+  uint i;
+
+  printf("Testing heaps\n");
+  heap_init(&h, 8);
+  for (i = 0; i < 8; i++)
+    heap_push(&h, i, (i * 5) % 8); /* keys 0 5 2 7 4 1 6 3 */
+  assert(h.size == 8);
+  assert(heap_top(&h) == 0);
+
+  heap_update(&h, 0, 10);  /* increase-key */
+  assert(heap_top(&h) == 5);
+  heap_update(&h, 3, 0);   /* decrease-key */
+  assert(heap_top(&h) == 3);
+  heap_remove(&h, 3);
+  assert(!heap_contains(&h, 3));
+
+  /* remaining keys: 5->1 2->2 7->3 4->4 1->5 6->6 0->10 */
+  assert(heap_pop(&h) == 5);
+  assert(heap_pop(&h) == 2);
+  assert(heap_pop(&h) == 7);
+  assert(heap_pop(&h) == 4);
+  assert(heap_pop(&h) == 1);
+  assert(heap_pop(&h) == 6);
+  assert(heap_pop(&h) == 0);
+  assert(h.size == 0);
+  heap_free(&h);
+}
@@ -0,0 +1,58 @@
+/*
+ * heap.h - Indexed binary min-heap over small integer ids (e.g. pfns).
+ *          Each id carries a 64-bit key; the id with the smallest key is
+ *          at the top. Because the heap tracks where every id lives,
+ *          the key of a queued id can be raised or lowered in O(log n),
+ *          which is what lets replacement algorithms update priorities
+ *          on every hit instead of rescanning physmem on a fault.
+ *
+ */
+
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <vmsim.h>
+
+typedef unsigned long long heap_key_t;
+
+/* pos[] value for ids that are not in the heap. */
+#define HEAP_NONE ((uint)-1)
+
+typedef struct _heap {
+  uint *items;      /* ids, in heap order */
+  uint *pos;        /* pos[id] is the index of id in items, or HEAP_NONE */
+  heap_key_t *keys; /* keys[id] is the current key of id */
+  uint size;
+  uint capacity;    /* ids must be < capacity */
+} heap_t;
+
+/* Allocate an empty heap able to hold ids 0..capacity-1. */
+void heap_init(heap_t *h, uint capacity);
+void heap_free(heap_t *h);
+
+static inline bool_t heap_contains(heap_t *h, uint id) {
+  return h->pos[id] != HEAP_NONE;
+}
+
+/* The id with the smallest key. The heap must not be empty. */
+static inline uint heap_top(heap_t *h) {
+  return h->items[0];
+}
+
+static inline heap_key_t heap_key(heap_t *h, uint id) {
+  return h->keys[id];
+}
+
+void heap_push(heap_t *h, uint id, heap_key_t key);
+
+/* Remove and return the id with the smallest key. */
+uint heap_pop(heap_t *h);
+
+void heap_remove(heap_t *h, uint id);
+
+/* Change the key of an id already in the heap, in either direction. */
+void heap_update(heap_t *h, uint id, heap_key_t key);
+
+void heap_test();
+
+#endif /* HEAP_H */
@@ -0,0 +1,233 @@
+/*
+ * huge.c - Huge page promotion and demotion. See huge.h.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vmsim.h>
+#include <util.h>
+#include <options.h>
+#include <pagetable.h>
+#include <stats.h>
+#include <fault.h>
+#include <proc.h>
+#include <sim.h>
+#include <trace.h>
+#include <tlb.h>
+#include <huge.h>
+
+/* Initial size of the region table, as a power of 2. */
+#define HUGE_MIN_BITS 10
+
+huge_t *huge_new(const opts_t *opts) {
+  huge_t *huge = (huge_t*)calloc(1, sizeof(huge_t));
+
+  assert(huge);
+  assert(opts->huge_pagesize > opts->pagesize);
+  huge->pages = opts->huge_pagesize / opts->pagesize;
+  huge->shift = log_2(huge->pages);
+  /* At least one resident page: the one that faulted. */
+  huge->promote = ((unsigned long long)huge->pages * opts->huge_promote + 99) / 100;
+  if (huge->promote == 0)
+    huge->promote = 1;
+  huge->bits = HUGE_MIN_BITS;
+  huge->table = (huge_region_t*)calloc((size_t)1 << huge->bits,
+				       sizeof(huge_region_t));
+  assert(huge->table);
+  return huge;
+}
+
+void huge_free(huge_t *huge) {
+  free(huge->table);
+  free(huge);
+}
+
+/* Fibonacci hashing of the region, mixed with the process. */
+static inline size_t huge_hash(proc_t *proc, vfn_t region, uint bits) {
+  return (size_t)(((region ^ (vfn_t)(size_t)proc) * 0x9e3779b97f4a7c15ULL) >>
+		  (64 - bits));
+}
+
+/* Double the region table and reinsert every region. */
+static void huge_grow(huge_t *huge) {
+  huge_region_t *old = huge->table;
+  size_t n, i, mask, old_slots = (size_t)1 << huge->bits;
+
+  huge->bits++;
+  mask = ((size_t)1 << huge->bits) - 1;
+  huge->table = (huge_region_t*)calloc(mask + 1, sizeof(huge_region_t));
+  assert(huge->table);
+  for (n = 0; n < old_slots; n++) {
+    if (old[n].proc == NULL)
+      continue;
+    i = huge_hash(old[n].proc, old[n].region, huge->bits);
+    while (huge->table[i].proc != NULL)
+      i = (i + 1) & mask;
+    huge->table[i] = old[n];
+  }
+  free(old);
+}
+
+/* The region holding pte, created if none of its pages was loaded
+ * before. Regions are never removed. */
+static huge_region_t *huge_region(huge_t *huge, pte_t *pte) {
+  size_t mask = ((size_t)1 << huge->bits) - 1;
+  vfn_t region = pte->vfn >> huge->shift;
+  size_t i = huge_hash(pte->proc, region, huge->bits);
+  huge_region_t *r;
+
+  while ((r = &huge->table[i])->proc != NULL) {
+    if (r->region == region && r->proc == pte->proc)
+      return r;
+    i = (i + 1) & mask;
+  }
+  r->proc = pte->proc;
+  r->region = region;
+  r->resident = 0;
+  r->huge = FALSE;
+  /* Keep the table at most half full so probe sequences stay short. */
+  if (++huge->used > mask / 2) {
+    huge_grow(huge);
+    return huge_region(huge, pte);
+  }
+  return r;
+}
+
+/* Set pte->huge on every page of region r, which are all resident. */
+static void huge_mark(sim_t *sim, huge_t *huge, huge_region_t *r,
+		      bool_t on) {
+  pagetable_t *pt = r->proc->pagetable;
+  vfn_t vfn = r->region << huge->shift;
+  uint i;
+
+  for (i = 0; i < huge->pages; i++)
+    pagetable_lookup(sim, pt, vfn + i, REF_KIND_PREFETCH)->huge = on;
+}
+
+void huge_load(sim_t *sim, pte_t *pte) {
+  huge_region(sim->huge, pte)->resident++;
+}
+
+void huge_evict(sim_t *sim, pte_t *pte) {
+  huge_t *huge = sim->huge;
+  huge_region_t *r = huge_region(huge, pte);
+
+  assert(r->resident > 0);
+  r->resident--;
+  if (pte->filled) {
+    sim->stats->huge_unused++;
+    pte->filled = FALSE;
+  }
+  if (r->huge) {
+    /* The caller has already dropped the huge TLB entry. */
+    huge_mark(sim, huge, r, FALSE);
+    r->huge = FALSE;
+    huge->now--;
+    sim->stats->huge_demotions++;
+  }
+}
+
+void huge_fault(sim_t *sim, proc_t *proc, pte_t *pte, ref_kind_t type) {
+  huge_t *huge = sim->huge;
+  sim_t *frames = proc->frames ? proc->frames : sim;
+  huge_region_t *r;
+  pte_t *fill;
+  vfn_t vfn;
+  uint i;
+
+  if (!pte->valid)
+    return;
+  r = huge_region(huge, pte);
+  if (r->huge || r->resident < huge->promote)
+    return;
+
+  vfn = r->region << huge->shift;
+  for (i = 0; i < huge->pages; i++) {
+    fill = pagetable_lookup(sim, proc->pagetable, vfn + i, REF_KIND_PREFETCH);
+    if (fill->valid)
+      continue;
+    frames->ref_counter = sim->ref_counter;
+    sim->opts.fault_handler->handler(frames, fill, type);
+    fill->filled = TRUE;
+    sim->stats->huge_filled++;
+  }
+  /* Loading the region may have evicted some of it again. */
+  if (r->resident < huge->pages)
+    return;
+  huge_mark(sim, huge, r, TRUE);
+  r->huge = TRUE;
+  if (++huge->now > huge->peak)
+    huge->peak = huge->now;
+  sim->stats->huge_promotions++;
+  sim->stats->huge_faults++;
+}
+
+void huge_output(sim_t *sim, FILE *o) {
+  huge_t *huge = sim->huge;
+  stats_t *stats = sim->stats;
+  count_t faults = stats_total(stats->miss);
+  count_t refs = stats_total(stats->references);
+  uint pfn, resident = 0;
+
+  for (pfn = 0; pfn < sim->opts.phys_pages; pfn++)
+    if (sim->physmem[pfn])
+      resident++;
+  fprintf(o, "\n Huge Pages (%u bytes, %u base pages; promoted at %u resident):\n",
+	  sim->opts.huge_pagesize, huge->pages, huge->promote);
+  fprintf(o, "\tPage Faults: %u base, %u huge\n", faults - stats->huge_faults,
+	  stats->huge_faults);
+  fprintf(o, "\tPromotions: %u, Demotions: %u\n", stats->huge_promotions,
+	  stats->huge_demotions);
+  fprintf(o, "\tResident: %u huge pages (%u frames, peak %u huge pages), %u base pages\n",
+	  huge->now, huge->now * huge->pages, huge->peak,
+	  resident - huge->now * huge->pages);
+  fprintf(o, "\tReferences to Huge Pages: %u (%.2f%%)\n", stats->huge_references,
+	  refs ? 100.0 * stats->huge_references / refs : 0.0);
+  fprintf(o, "\tPages Filled by Promotion: %u (evicted unreferenced %u)\n",
+	  stats->huge_filled, stats->huge_unused);
+}
+
+/* Touch pages[] of a 4 page region with 8 frames of LRU, promoting at
+ * half the region. */
+static sim_t *huge_test_run(const int *pages, int count) {
+  opts_t config;
+  sim_t *sim;
+
+  sim_test_config(&config, "lru", 8);
+  config.tlb_levels = 1;
+  config.tlb[0].entries = 4;
+  config.tlb[0].ways = 4;
+  config.tlb[0].policy = TLB_LRU;
+  config.huge_pagesize = 64;
+  config.huge_promote = 50;
+  sim = sim_new(&config);
+  sim_test_pages(sim, pages, count);
+  return sim;
+}
+
+void huge_test() {
+  /* The second page promotes 0-3; 2 and 3 then hit through one entry */
+  static const int promote[] = { 0, 1, 2, 3, 1 };
+  /* Faulting in 12 evicts 0, splitting 0-3; promoting 12-15 then evicts
+   * the rest of it, 2 and 3 unused. Faulting 2 back splits 8-11. */
+  static const int demote[] = { 0, 1, 8, 9, 12, 13, 2 };
+  sim_t *sim;
+
+  printf("Testing huge pages\n");
+  sim = huge_test_run(promote, 5);
+  assert(stats_total(sim->stats->miss) == 2);
+  assert(sim->stats->huge_promotions == 1 && sim->stats->huge_faults == 1);
+  assert(sim->stats->huge_filled == 2 && sim->huge->now == 1);
+  assert(sim->stats->tlb_misses == 2 && sim->stats->tlb_hits == 3);
+  assert(sim->stats->huge_references == 3);
+  sim_free(sim);
+
+  sim = huge_test_run(demote, 7);
+  assert(sim->stats->huge_promotions == 3);
+  assert(sim->stats->huge_demotions == 2 && sim->huge->now == 1);
+  assert(sim->stats->huge_unused == 2);
+  assert(stats_total(sim->stats->miss) == 7);
+  sim_free(sim);
+}
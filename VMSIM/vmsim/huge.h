@@ -0,0 +1,69 @@
+/*
+ * huge.h - Huge pages (-H SIZE[:PROMOTE]).
+ *
+ *          Each address space is divided into aligned regions of SIZE
+ *          bytes, SIZE / pagesize base pages each. A fault that leaves at
+ *          least PROMOTE percent of its region resident promotes the
+ *          region to a huge page: the rest of the region is brought in
+ *          through the fault handler as part of that one fault, and from
+ *          then on one TLB entry translates the whole region, which is
+ *          mapped one page table level higher. Pages brought in by a
+ *          promotion and evicted unreferenced are the huge page's
+ *          internal fragmentation.
+ *
+ *          Replacement still works on base frames. Evicting any page of a
+ *          huge page first splits it back into base pages (demotes it),
+ *          as reclaim splits transparent huge pages; a later fault can
+ *          promote the region again.
+ */
+
+#ifndef HUGE_H
+#define HUGE_H
+
+#include <stdio.h>
+
+#include <vmsim.h>
+#include <options.h>
+#include <pagetable.h>
+
+#define HUGE_PROMOTE_DEFAULT 50
+
+/* The state of one region of one address space. */
+typedef struct _huge_region {
+  proc_t *proc;   /* NULL if the slot is empty */
+  vfn_t region;   /* vfn >> shift */
+  uint resident;  /* base pages of the region in memory */
+  bool_t huge;
+} huge_region_t;
+
+typedef struct _huge {
+  uint shift;     /* log_2(pages) */
+  uint pages;     /* base pages per huge page */
+  uint promote;   /* resident base pages that promote a region */
+  uint now;       /* regions that are huge pages */
+  uint peak;
+  /* Every region with a page loaded so far, open addressed like the
+   * hashed page tables. */
+  huge_region_t *table;
+  uint bits;
+  size_t used;
+} huge_t;
+
+/* opts->huge_pagesize must be set, and larger than opts->pagesize. */
+huge_t *huge_new(const opts_t *opts);
+void huge_free(huge_t *huge);
+
+/* physmem_load and physmem_evict report every base page that comes and
+ * goes; evicting a page of a huge page demotes it. */
+void huge_load(sim_t *sim, pte_t *pte);
+void huge_evict(sim_t *sim, pte_t *pte);
+
+/* Called by sim_reference() after pte of proc faulted, to promote its
+ * region if it is now dense enough. */
+void huge_fault(sim_t *sim, proc_t *proc, pte_t *pte, ref_kind_t type);
+
+void huge_output(sim_t *sim, FILE *o);
+
+void huge_test();
+
+#endif /* HUGE_H */
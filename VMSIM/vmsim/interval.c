@@ -0,0 +1,149 @@
+/*
+ * interval.c - Interval statistics. See interval.h.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vmsim.h>
+#include <options.h>
+#include <stats.h>
+#include <trace.h>
+#include <sim.h>
+#include <interval.h>
+
+/* Rows are written out when this much has built up. */
+#define INTERVAL_BUFFER (1 << 20)
+
+static const char *interval_fields[] = {
+  "references", "faults", "compulsory", "evictions", "dirty_writes"
+};
+static const char *interval_kinds[] = { "code", "load", "store" };
+
+/* The per-type counts of stats, in the order of interval_fields. */
+static count_t *interval_counts(stats_t *stats, int field) {
+  switch (field) {
+  case 0: return stats->references;
+  case 1: return stats->miss;
+  case 2: return stats->compulsory;
+  case 3: return stats->evictions;
+  default: return stats->evict_dirty;
+  }
+}
+
+interval_t *interval_new(const opts_t *opts) {
+  interval_t *iv = (interval_t*)calloc(1, sizeof(interval_t));
+  const char *dot;
+
+  assert(iv && opts->interval_every > 0);
+  iv->every = iv->next = opts->interval_every;
+  iv->faults = opts->interval_faults;
+  if (opts->interval_file) {
+    iv->out = fopen(opts->interval_file, "w");
+    if (iv->out == NULL) {
+      perror("vmsim: unable to open interval file for write");
+      exit(1);
+    }
+    dot = strrchr(opts->interval_file, '.');
+    iv->json = dot && (strcmp(dot, ".json") == 0 || strcmp(dot, ".jsonl") == 0);
+    iv->buf = (char*)malloc(INTERVAL_BUFFER);
+    assert(iv->buf);
+    setvbuf(iv->out, iv->buf, _IOFBF, INTERVAL_BUFFER);
+  } else {
+    /* Already in use; it keeps its own buffering. */
+    iv->out = stdout;
+  }
+  return iv;
+}
+
+void interval_row(interval_t *iv, stats_t *stats) {
+  count_t *now, *then;
+  int f, k;
+
+  /* The header waits for the first row, after the simulation's banner. */
+  if (iv->rows == 0 && !iv->json) {
+    fprintf(iv->out, "interval,end_reference");
+    for (f = 0; f < 5; f++)
+      for (k = 0; k < REF_KIND_NUM; k++)
+	fprintf(iv->out, ",%s_%s", interval_fields[f], interval_kinds[k]);
+    fprintf(iv->out, ",resident\n");
+  }
+  if (iv->json)
+    fprintf(iv->out, "{\"interval\":%u,\"end_reference\":%u", iv->rows,
+	    stats_total(stats->references));
+  else
+    fprintf(iv->out, "%u,%u", iv->rows, stats_total(stats->references));
+  for (f = 0; f < 5; f++) {
+    now = interval_counts(stats, f);
+    then = interval_counts(&iv->last, f);
+    if (iv->json)
+      fprintf(iv->out, ",\"%s\":[%u,%u,%u]", interval_fields[f],
+	      now[0] - then[0], now[1] - then[1], now[2] - then[2]);
+    else
+      for (k = 0; k < REF_KIND_NUM; k++)
+	fprintf(iv->out, ",%u", now[k] - then[k]);
+  }
+  fprintf(iv->out, iv->json ? ",\"resident\":%u}\n" : ",%u\n",
+	  stats->resident);
+  iv->last = *stats;
+  iv->rows++;
+  iv->next += iv->every;
+}
+
+void interval_finish(interval_t *iv, stats_t *stats) {
+  if (stats_total(stats->references) > stats_total(iv->last.references))
+    interval_row(iv, stats);
+  fflush(iv->out);
+}
+
+void interval_free(interval_t *iv) {
+  if (iv->out != stdout)
+    fclose(iv->out);
+  free(iv->buf);
+  free(iv);
+}
+
+/* Rows every 2 faults of LRU in 3 frames, read back from a file. */
+void interval_test() {
+  static const int pages[] = { 0, 1, 2, 0, 3, 1 };
+  /* end_reference, references, faults and resident of each row */
+  static const uint expect[3][4] = { { 2, 2, 2, 2 }, { 5, 3, 2, 3 },
+				     { 6, 1, 1, 3 } };
+  char path[] = "/tmp/vmsim-intervalXXXXXX.csv", line[512];
+  opts_t config;
+  uint row, end, refs, faults, resident, skip;
+  sim_t *sim;
+  FILE *in;
+  int i, fd;
+
+  printf("Testing interval statistics\n");
+  fd = mkstemps(path, 4);
+  assert(fd >= 0);
+  close(fd);
+  sim_test_config(&config, "lru", 3);
+  config.interval_every = 2;
+  config.interval_faults = TRUE;
+  config.interval_file = path;
+  sim = sim_new(&config);
+  sim_test_pages(sim, pages, 6);
+  interval_finish(sim->interval, sim->stats);
+  sim_free(sim);
+
+  in = fopen(path, "r");
+  assert(in && fgets(line, sizeof(line), in));
+  assert(strncmp(line, "interval,end_reference,", 23) == 0);
+  for (i = 0; i < 3; i++) {
+    assert(fgets(line, sizeof(line), in));
+    assert(sscanf(line, "%u,%u,%u,%u,%u,%u,%u,%u", &row, &end, &skip, &refs,
+		  &skip, &skip, &faults, &skip) == 8);
+    resident = atoi(strrchr(line, ',') + 1);
+    assert(row == i && end == expect[i][0] && refs == expect[i][1] &&
+	   faults == expect[i][2] && resident == expect[i][3]);
+  }
+  assert(fgets(line, sizeof(line), in) == NULL);
+  fclose(in);
+  unlink(path);
+}
@@ -0,0 +1,57 @@
+/*
+ * interval.h - Interval statistics (-i N[f][:FILE]).
+ *
+ *              Every N references, or every N faults with 'f', one row
+ *              gives what happened during that interval: references,
+ *              faults, compulsory faults, evictions and dirty page writes
+ *              by reference type, and the frames resident at its end. A
+ *              last, shorter row covers whatever follows the last full
+ *              interval. Rows are CSV, or JSON Lines if FILE ends in
+ *              .json or .jsonl, written to FILE or to stdout.
+ *
+ *              The per-reference cost is one comparison; rows to a FILE
+ *              are formatted into a large stdio buffer that is written
+ *              out only when it fills.
+ */
+
+#ifndef INTERVAL_H
+#define INTERVAL_H
+
+#include <stdio.h>
+
+#include <vmsim.h>
+#include <options.h>
+#include <stats.h>
+
+typedef struct _interval {
+  FILE *out;
+  char *buf;          /* out's buffer, unless out is stdout */
+  bool_t json;
+  bool_t faults;      /* N counts faults, not references */
+  count_t every;      /* N */
+  count_t next;       /* the count that ends the current interval */
+  uint rows;
+  stats_t last;       /* the totals when the last row was written */
+} interval_t;
+
+/* Open the series described by opts->interval_*, opts->interval_every
+ * being > 0. */
+interval_t *interval_new(const opts_t *opts);
+
+/* Write the remaining partial interval, if any, at the end of the
+ * trace. */
+void interval_finish(interval_t *iv, stats_t *stats);
+void interval_free(interval_t *iv);
+
+void interval_row(interval_t *iv, stats_t *stats);
+
+/* Called by sim_reference() after every reference. */
+static inline void interval_tick(interval_t *iv, stats_t *stats) {
+  if ((iv->faults ? stats_total(stats->miss) :
+       stats_total(stats->references)) >= iv->next)
+    interval_row(iv, stats);
+}
+
+void interval_test();
+
+#endif /* INTERVAL_H */
@@ -0,0 +1,53 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include <list.h>
+
+typedef struct _list_test_item {
+  int value;
+  list_node_t link;
+} list_test_item_t;
+
+void list_test() {
+  list_t l;
+  list_test_item_t items[3];
+  int i;
+
+  printf("Testing lists\n");
+  list_init(&l);
+  assert(list_empty(&l) && list_front(&l) == NULL);
+
+  for (i = 0; i < 3; i++) {
+    items[i].value = i;
+    items[i].link.next = NULL;
+    assert(!list_linked(&items[i].link));
+    list_push_front(&l, &items[i].link);
+  }
+  /* 2 1 0 */
+  assert(l.size == 3);
+  assert(list_entry(list_front(&l), list_test_item_t, link)->value == 2);
+  assert(list_entry(list_back(&l), list_test_item_t, link)->value == 0);
+
+  list_move_front(&l, &items[0].link);
+  /* 0 2 1 */
+  assert(list_entry(list_front(&l), list_test_item_t, link)->value == 0);
+  assert(list_entry(list_back(&l), list_test_item_t, link)->value == 1);
+
+  assert(list_pop_back(&l) == &items[1].link);
+  assert(!list_linked(&items[1].link));
+  list_remove(&l, &items[0].link);
+  assert(l.size == 1 && list_front(&l) == &items[2].link);
+  list_push_back(&l, &items[1].link);
+  assert(list_pop_front(&l) == &items[2].link);
+  assert(list_pop_front(&l) == &items[1].link);
+  assert(list_empty(&l) && l.size == 0);
+
+  /* rings: 2, 0, 1 */
+  list_push_back(&l, &items[2].link);
+  list_push_back(&l, &items[1].link);
+  list_insert_before(&l, &items[1].link, &items[0].link);
+  assert(l.size == 3 && list_ring_next(&l, &items[2].link) == &items[0].link);
+  assert(list_ring_next(&l, &items[1].link) == &items[2].link);
+  assert(list_ring_prev(&l, &items[2].link) == &items[1].link);
+  assert(list_ring_prev(&l, &items[0].link) == &items[2].link);
+}
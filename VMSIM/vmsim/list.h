@@ -0,0 +1,121 @@
+/*
+ * list.h - Intrusive circular doubly-linked lists. A list_node_t is
+ *          embedded in the structure being linked (e.g. pte_t), so
+ *          insertion, removal and move-to-front are O(1) and never
+ *          allocate.
+ *
+ */
+
+#ifndef LIST_H
+#define LIST_H
+
+#include <stddef.h>
+#include <vmsim.h>
+
+typedef struct _list_node {
+  struct _list_node *prev;
+  struct _list_node *next; /* NULL iff the node is not on any list */
+} list_node_t;
+
+/* head is a sentinel: head.next is the front, head.prev the back. */
+typedef struct _list {
+  list_node_t head;
+  uint size;
+} list_t;
+
+/* Static initializer, e.g. static list_t l = LIST_INIT(l); */
+#define LIST_INIT(l) { { &(l).head, &(l).head }, 0 }
+
+/* Recover the structure containing the given node. */
+#define list_entry(node, type, member) \
+  ((type*)((char*)(node) - offsetof(type, member)))
+
+static inline void list_init(list_t *l) {
+  l->head.prev = l->head.next = &l->head;
+  l->size = 0;
+}
+
+static inline bool_t list_empty(list_t *l) {
+  return l->head.next == &l->head;
+}
+
+static inline bool_t list_linked(list_node_t *n) {
+  return n->next != NULL;
+}
+
+static inline list_node_t *list_front(list_t *l) {
+  return list_empty(l) ? NULL : l->head.next;
+}
+
+static inline list_node_t *list_back(list_t *l) {
+  return list_empty(l) ? NULL : l->head.prev;
+}
+
+static inline void _list_insert(list_node_t *n, list_node_t *prev,
+				list_node_t *next) {
+  n->prev = prev;
+  n->next = next;
+  prev->next = n;
+  next->prev = n;
+}
+
+static inline void list_push_front(list_t *l, list_node_t *n) {
+  _list_insert(n, &l->head, l->head.next);
+  l->size++;
+}
+
+static inline void list_push_back(list_t *l, list_node_t *n) {
+  _list_insert(n, l->head.prev, &l->head);
+  l->size++;
+}
+
+static inline void list_remove(list_t *l, list_node_t *n) {
+  n->prev->next = n->next;
+  n->next->prev = n->prev;
+  n->prev = n->next = NULL;
+  l->size--;
+}
+
+static inline list_node_t *list_pop_back(list_t *l) {
+  list_node_t *n = list_back(l);
+  if (n)
+    list_remove(l, n);
+  return n;
+}
+
+static inline list_node_t *list_pop_front(list_t *l) {
+  list_node_t *n = list_front(l);
+  if (n)
+    list_remove(l, n);
+  return n;
+}
+
+/* Insert n into l just before pos, which must be on l. */
+static inline void list_insert_before(list_t *l, list_node_t *pos,
+				      list_node_t *n) {
+  _list_insert(n, pos->prev, pos);
+  l->size++;
+}
+
+/* The nodes after and before n, treating l as a ring: the sentinel is
+ * skipped, so the back is followed by the front. */
+static inline list_node_t *list_ring_next(list_t *l, list_node_t *n) {
+  return n->next == &l->head ? l->head.next : n->next;
+}
+
+static inline list_node_t *list_ring_prev(list_t *l, list_node_t *n) {
+  return n->prev == &l->head ? l->head.prev : n->prev;
+}
+
+/* Move n, which must already be on l, to the front of l. */
+static inline void list_move_front(list_t *l, list_node_t *n) {
+  if (l->head.next == n)
+    return;
+  n->prev->next = n->next;
+  n->next->prev = n->prev;
+  _list_insert(n, &l->head, l->head.next);
+}
+
+void list_test();
+
+#endif /* LIST_H */
@@ -0,0 +1,213 @@
+/*
+ * mrc.c - Stack distances are counted with a Fenwick tree over access
+ *         timestamps: timestamp t is marked iff it is the most recent
+ *         access of some page, so the stack distance of a page last
+ *         touched at t0 is the number of marks in [t0, now). Each
+ *         reference is O(log n).
+ *
+ *         Timestamps are renumbered 1..distinct whenever the tree fills
+ *         up, which keeps memory proportional to the number of distinct
+ *         pages rather than to the length of the trace.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <vmsim.h>
+#include <options.h>
+#include <pagetable.h>
+#include <stats.h>
+#include <rng.h>
+#include <sim.h>
+#include <mrc.h>
+
+#define MRC_MIN_CAPACITY 4096
+
+struct _mrc {
+  uint *tree;      /* Fenwick tree over timestamps 1..capacity */
+  pte_t **owner;   /* owner[t] is the page last accessed at t, or NULL */
+  uint capacity;
+  uint now;        /* latest timestamp handed out */
+
+  ulong *hist;     /* hist[d] counts references at stack distance d */
+  uint hist_size;
+  uint distinct;   /* distinct pages seen = cold misses */
+};
+
+static void mrc_compact(mrc_t *mrc);
+
+static inline void fenwick_add(mrc_t *mrc, uint t, int delta) {
+  for (; t <= mrc->capacity; t += t & -t)
+    mrc->tree[t] += delta;
+}
+
+/* Number of marks in [1, t]. */
+static inline uint fenwick_sum(mrc_t *mrc, uint t) {
+  uint sum = 0;
+  for (; t > 0; t -= t & -t)
+    sum += mrc->tree[t];
+  return sum;
+}
+
+mrc_t *mrc_new() {
+  return mrc_new_sized(MRC_MIN_CAPACITY);
+}
+
+mrc_t *mrc_new_sized(uint capacity) {
+  mrc_t *mrc = (mrc_t*)calloc(1, sizeof(mrc_t));
+  assert(mrc && capacity > 0);
+  mrc->capacity = capacity;
+  mrc->tree = (uint*)calloc(mrc->capacity + 1, sizeof(uint));
+  mrc->owner = (pte_t**)calloc(mrc->capacity + 1, sizeof(pte_t*));
+  mrc->hist_size = MRC_MIN_CAPACITY;
+  mrc->hist = (ulong*)calloc(mrc->hist_size, sizeof(ulong));
+  assert(mrc->tree && mrc->owner && mrc->hist);
+  return mrc;
+}
+
+void mrc_free(mrc_t *mrc) {
+  free(mrc->tree);
+  free(mrc->owner);
+  free(mrc->hist);
+  free(mrc);
+}
+
+void mrc_reference(mrc_t *mrc, pte_t *pte) {
+  uint distance;
+
+  if (mrc->now == mrc->capacity)
+    mrc_compact(mrc);
+  mrc->now++;
+
+  if (pte->mrc_time) {
+    distance = fenwick_sum(mrc, mrc->now - 1) -
+      fenwick_sum(mrc, pte->mrc_time - 1);
+    mrc->hist[distance]++;
+    fenwick_add(mrc, pte->mrc_time, -1);
+    mrc->owner[pte->mrc_time] = NULL;
+  } else {
+    mrc->distinct++;
+    if (mrc->distinct == mrc->hist_size) {
+      mrc->hist = (ulong*)realloc(mrc->hist,
+				  2 * mrc->hist_size * sizeof(ulong));
+      assert(mrc->hist);
+      memset(mrc->hist + mrc->hist_size, 0, mrc->hist_size * sizeof(ulong));
+      mrc->hist_size *= 2;
+    }
+  }
+
+  fenwick_add(mrc, mrc->now, 1);
+  mrc->owner[mrc->now] = pte;
+  pte->mrc_time = mrc->now;
+}
+
+/* Renumber the live timestamps 1..distinct, preserving their order, and
+ * make room for at least as many new references as there are pages. */
+void mrc_compact(mrc_t *mrc) {
+  pte_t **owner = mrc->owner;
+  uint t, live = 0, next;
+
+  for (t = 1; t <= mrc->now; t++) {
+    if (owner[t]) {
+      owner[++live] = owner[t];
+      owner[live]->mrc_time = live;
+    }
+  }
+  assert(live == mrc->distinct);
+
+  if (mrc->capacity < 2 * live) {
+    mrc->capacity = 2 * live;
+    mrc->tree = (uint*)realloc(mrc->tree, (mrc->capacity + 1) * sizeof(uint));
+    owner = mrc->owner = (pte_t**)realloc(owner, (mrc->capacity + 1) *
+					  sizeof(pte_t*));
+    assert(mrc->tree && owner);
+  }
+  for (t = live + 1; t <= mrc->capacity; t++)
+    owner[t] = NULL;
+
+  /* O(n) Fenwick build over marks at 1..live */
+  for (t = 1; t <= mrc->capacity; t++)
+    mrc->tree[t] = (t <= live);
+  for (t = 1; t <= mrc->capacity; t++) {
+    next = t + (t & -t);
+    if (next <= mrc->capacity)
+      mrc->tree[next] += mrc->tree[t];
+  }
+  mrc->now = live;
+}
+
+void mrc_output(mrc_t *mrc, FILE *o) {
+  ulong *hist = mrc->hist;
+  uint distinct = mrc->distinct;
+  uint d, pages, max_pages;
+  ulong *faults, misses;
+
+  max_pages = distinct > MIN_PHYS_PAGES ? distinct : MIN_PHYS_PAGES;
+  faults = (ulong*)malloc((max_pages + 1) * sizeof(ulong));
+  assert(faults);
+
+  /* faults[m] = cold misses + references with stack distance > m */
+  misses = distinct;
+  for (d = max_pages; d > 0; d--) {
+    faults[d] = misses;
+    if (d <= distinct)
+      misses += hist[d];
+  }
+
+  fprintf(o, "\n LRU Miss Ratio Curve (stack distance, one pass):");
+  fprintf(o, "\n\tphys_pages, page_faults\n");
+  for (pages = MIN_PHYS_PAGES; pages <= max_pages; pages++)
+    fprintf(o, "\t%u, %lu\n", pages, faults[pages]);
+  free(faults);
+}
+
+ulong mrc_faults(const mrc_t *mrc, uint pages) {
+  ulong faults = mrc->distinct;
+  uint d;
+
+  for (d = pages + 1; d <= mrc->distinct; d++)
+    faults += mrc->hist[d];
+  return faults;
+}
+
+/* The curve over 3000 references, nine in ten to 8 hot pages and the
+ * rest to 24 others, must match an lru run at every size. A tree of 16
+ * timestamps compacts, and grows, many times along the way. */
+void mrc_test() {
+  int pages[3000];
+  ulong compactions = 0;
+  opts_t config;
+  sim_t *sim, *lru;
+  uint frames, last;
+  rng_t rng;
+  int i;
+
+  printf("Testing lru-mrc\n");
+  rng_seed(&rng, 6, 6);
+  for (i = 0; i < 3000; i++)
+    pages[i] = rng_below(&rng, 10) ? rng_below(&rng, 8) :
+      8 + rng_below(&rng, 24);
+  sim_test_config(&config, "lru", MIN_PHYS_PAGES);
+  config.mrc = TRUE;
+  sim = sim_new(&config);
+  mrc_free(sim->mrc);
+  sim->mrc = mrc_new_sized(16);
+  for (i = 0; i < 3000; i++) {
+    last = sim->mrc->now;
+    sim_test_pages(sim, &pages[i], 1);
+    compactions += sim->mrc->now < last;
+  }
+  assert(compactions > 100 && sim->mrc->distinct == 32);
+
+  config.mrc = FALSE;
+  for (frames = MIN_PHYS_PAGES; frames <= 33; frames++) {
+    config.phys_pages = frames;
+    lru = sim_new(&config);
+    sim_test_pages(lru, pages, 3000);
+    assert(mrc_faults(sim->mrc, frames) == stats_total(lru->stats->miss));
+    sim_free(lru);
+  }
+  sim_free(sim);
+}
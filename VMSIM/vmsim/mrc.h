@@ -0,0 +1,38 @@
+/*
+ * mrc.h - One-pass LRU miss ratio curve (the lru-mrc algorithm).
+ *
+ * Mattson's stack algorithm: under LRU a reference hits in a memory of
+ * m pages iff fewer than m distinct pages were touched since the page's
+ * previous reference (its stack distance). Recording a histogram of
+ * stack distances therefore gives the fault count for every memory size
+ * at once, instead of one vmsim run per -p value.
+ */
+
+#ifndef MRC_H
+#define MRC_H
+
+#include <stdio.h>
+#include <vmsim.h>
+#include <pagetable.h>
+
+typedef struct _mrc mrc_t;
+
+mrc_t *mrc_new();
+/* As mrc_new, but compacting once capacity timestamps are handed out. */
+mrc_t *mrc_new_sized(uint capacity);
+void mrc_free(mrc_t *mrc);
+
+/* Account for one reference to pte. Called by sim_reference() for every
+ * reference, hit or miss. */
+void mrc_reference(mrc_t *mrc, pte_t *pte);
+
+/* Print the fault count for every size from MIN_PHYS_PAGES up to the
+ * number of distinct pages referenced. */
+void mrc_output(mrc_t *mrc, FILE *o);
+
+/* The fault count at one size. */
+ulong mrc_faults(const mrc_t *mrc, uint pages);
+
+void mrc_test();
+
+#endif /* MRC_H */
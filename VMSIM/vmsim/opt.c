@@ -0,0 +1,202 @@
+/*
+ * opt.c - Build next-use indexes for opt. See opt.h.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <vmsim.h>
+#include <util.h>
+#include <options.h>
+#include <trace.h>
+#include <stats.h>
+#include <proc.h>
+#include <sim.h>
+#include <opt.h>
+
+/* Initial size of the last-position map, as a power of 2. */
+#define OPT_MIN_BITS 10
+
+/* The last reference seen so far to one page. */
+typedef struct _opt_last {
+  vfn_t vfn;
+  uint pid;
+  uint pos;  /* OPT_NEVER for an empty slot */
+} opt_last_t;
+
+typedef struct _opt_builder {
+  uint *next;
+  ulong count;
+  ulong capacity;
+  opt_last_t *slots;
+  uint bits;
+  uint size;
+  uint addr_bits;
+  uint page_bits;
+} opt_builder_t;
+
+bool_t opt_needed(const fault_handler_info_t *alg) {
+  return strcmp(alg->name, "opt") == 0;
+}
+
+/* Size the index for capacity references; it grows if there are more. */
+static void opt_init(opt_builder_t *b, const opts_t *opts, ulong capacity) {
+  b->capacity = capacity ? capacity : 1;
+  b->next = (uint*)malloc(b->capacity * sizeof(uint));
+  assert(b->next);
+  b->count = 0;
+  b->bits = OPT_MIN_BITS;
+  b->size = 0;
+  b->slots = (opt_last_t*)malloc(pow_2(b->bits) * sizeof(opt_last_t));
+  assert(b->slots);
+  memset(b->slots, 0xff, pow_2(b->bits) * sizeof(opt_last_t));
+  b->addr_bits = opts->addr_bits;
+  b->page_bits = log_2(opts->pagesize);
+}
+
+/* Fibonacci hashing of the page, as for hashed page tables. */
+static inline size_t opt_hash(vfn_t vfn, uint pid, uint bits) {
+  return (size_t)(((vfn ^ (vfn_t)pid << 48) * 0x9e3779b97f4a7c15ULL) >>
+		  (64 - bits));
+}
+
+/* Find the slot of a page, or the empty slot it belongs in. */
+static opt_last_t *opt_slot(opt_builder_t *b, vfn_t vfn, uint pid) {
+  size_t mask = pow_2(b->bits) - 1;
+  size_t i = opt_hash(vfn, pid, b->bits);
+  opt_last_t *slot;
+
+  while ((slot = &b->slots[i])->pos != OPT_NEVER) {
+    if (slot->vfn == vfn && slot->pid == pid)
+      break;
+    i = (i + 1) & mask;
+  }
+  return slot;
+}
+
+/* Double the map and reinsert every page. */
+static void opt_grow(opt_builder_t *b) {
+  opt_last_t *old = b->slots;
+  size_t i, old_size = pow_2(b->bits);
+
+  b->bits++;
+  b->slots = (opt_last_t*)malloc(pow_2(b->bits) * sizeof(opt_last_t));
+  assert(b->slots);
+  memset(b->slots, 0xff, pow_2(b->bits) * sizeof(opt_last_t));
+  for (i = 0; i < old_size; i++)
+    if (old[i].pos != OPT_NEVER)
+      *opt_slot(b, old[i].vfn, old[i].pid) = old[i];
+  free(old);
+}
+
+/* Index one more reference: it is the next use of the page's previous
+ * reference, and for now the page's last. */
+static void opt_add(opt_builder_t *b, const trace_ref_t *ref) {
+  vfn_t vfn = vaddr_to_vfn(ref->vaddr, b->addr_bits, b->page_bits);
+  opt_last_t *slot;
+
+  if (b->count == OPT_NEVER) {
+    fprintf(stderr, "vmsim: trace too long for opt (more than %u references)\n",
+	    OPT_NEVER - 1);
+    exit(1);
+  }
+  if (b->count == b->capacity) {
+    b->capacity *= 2;
+    b->next = (uint*)realloc(b->next, b->capacity * sizeof(uint));
+    assert(b->next);
+  }
+
+  slot = opt_slot(b, vfn, ref->pid);
+  if (slot->pos != OPT_NEVER) {
+    b->next[slot->pos] = b->count;
+  } else {
+    slot->vfn = vfn;
+    slot->pid = ref->pid;
+    if (++b->size > (pow_2(b->bits) - 1) / 2) {
+      opt_grow(b);
+      slot = opt_slot(b, vfn, ref->pid);
+    }
+  }
+  slot->pos = b->count;
+  b->next[b->count++] = OPT_NEVER;
+}
+
+/* Release the map and trim the index to its references. */
+static uint *opt_finish(opt_builder_t *b) {
+  free(b->slots);
+  if (b->count < b->capacity) {
+    b->next = (uint*)realloc(b->next, (b->count ? b->count : 1) * sizeof(uint));
+    assert(b->next);
+  }
+  return b->next;
+}
+
+uint *opt_index_read(const opts_t *opts) {
+  opt_builder_t b;
+  trace_t *trace;
+  trace_ref_t ref;
+  ulong capacity = 1 << 16;
+
+  if (opts->input_file == NULL || strcmp(opts->input_file, "-") == 0) {
+    fprintf(stderr, "vmsim: opt reads the trace twice; it cannot be stdin\n");
+    exit(1);
+  }
+  trace = trace_open(opts->input_file);
+  /* A binary trace knows its length, so the index is allocated once. */
+  if (trace->map)
+    capacity = (trace->end - trace->next) / trace->rec_size;
+  if (opts->limit && capacity > opts->limit)
+    capacity = opts->limit;
+  opt_init(&b, opts, capacity);
+  while ((opts->limit == 0 || b.count < opts->limit) && trace_next(trace, &ref))
+    opt_add(&b, &ref);
+  trace_close(trace);
+  return opt_finish(&b);
+}
+
+uint *opt_index_refs(const opts_t *opts, const trace_ref_t *refs, ulong count) {
+  opt_builder_t b;
+  ulong i;
+
+  opt_init(&b, opts, count);
+  for (i = 0; i < count; i++)
+    opt_add(&b, &refs[i]);
+  return opt_finish(&b);
+}
+
+void opt_test() {
+  /* The textbook reference string: 9 faults with 3 frames under OPT. */
+  static const int pages[] = { 7, 0, 1, 2, 0, 3, 0, 4, 2, 3, 0, 3, 2, 1, 2,
+			       0, 1, 7, 0, 1 };
+  ulong count = sizeof(pages) / sizeof(pages[0]);
+  trace_ref_t refs[sizeof(pages) / sizeof(pages[0])];
+  opts_t config;
+  sim_t *sim;
+  uint *next;
+  ulong i;
+
+  printf("Testing opt\n");
+  sim_test_config(&config, "opt", 3);
+  assert(opt_needed(config.fault_handler));
+
+  for (i = 0; i < count; i++) {
+    refs[i].pid = 1;
+    refs[i].type = REF_KIND_LOAD;
+    refs[i].vaddr = pages[i] * 16 + (i % 16);
+  }
+  next = opt_index_refs(&config, refs, count);
+  assert(next[0] == 17);  /* 7 */
+  assert(next[1] == 4);   /* 0 */
+  assert(next[13] == 16); /* 1 */
+  assert(next[19] == OPT_NEVER);
+
+  sim = sim_new(&config);
+  sim->opt_next = next;
+  for (i = 0; i < count; i++)
+    sim_reference(sim, &refs[i]);
+  assert(stats_total(sim->stats->miss) == 9);
+  sim_free(sim);
+  free(next);
+}
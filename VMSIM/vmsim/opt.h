@@ -0,0 +1,38 @@
+/*
+ * opt.h - The next-use index behind the opt (Belady) fault handler.
+ *
+ *         OPT evicts the resident page whose next reference is farthest
+ *         away, which needs the future. Before replay the trace is read
+ *         once to find, for every reference i, the position of the next
+ *         reference to the same page; sim_reference copies that into the
+ *         pte (pte->next_ref) so the handler never looks ahead itself.
+ *
+ *         The index holds one uint per reference. While it is built, the
+ *         last position of every distinct (pid, vfn) is also kept; that
+ *         map is released once the index is complete.
+ */
+
+#ifndef OPT_H
+#define OPT_H
+
+#include <vmsim.h>
+#include <options.h>
+#include <trace.h>
+
+/* next[i] value for the last reference to a page. */
+#define OPT_NEVER ((uint)-1)
+
+/* TRUE if alg needs a next-use index (that is, it is opt). */
+bool_t opt_needed(const fault_handler_info_t *alg);
+
+/* Build the index for the trace named in opts, up to opts->limit
+ * references, reading it from start to end. The trace is read again for
+ * the simulation itself, so it must not be stdin. */
+uint *opt_index_read(const opts_t *opts);
+
+/* Build the index for references already in memory (sweep mode). */
+uint *opt_index_refs(const opts_t *opts, const trace_ref_t *refs, ulong count);
+
+void opt_test();
+
+#endif /* OPT_H */
@@ -15,14 +15,17 @@
 #include <options.h>
 #include <fault.h>
 #include <util.h>
+#include <pagetable.h>
+#include <writeback.h>
+#include <prefetch.h>
+#include <huge.h>
 
-#define MIN_PHYS_PAGES 3
 #define MIN_PAGESIZE 16
 
 /* Global options structure. process_options will set it's values */
 opts_t opts;
 
-static const char *shortopts = "hvtVp:s:l:o:";
+static const char *shortopts = "hvtVp:s:l:o:j:f:a:r:w:c:F:P:T:H:k:S:i:";
 
 /**********************************************************************/
 /* Handle systems without GNU libc-style longopt support              */
@@ -40,6 +43,19 @@ static const struct option longopts[] =
   { "limit", required_argument, NULL, 'l' },
   { "pages", required_argument, NULL, 'p' },
   { "size", required_argument, NULL, 's' },    
+  { "threads", required_argument, NULL, 'j' },
+  { "flat", required_argument, NULL, 'f' },
+  { "addr-bits", required_argument, NULL, 'a' },
+  { "replacement", required_argument, NULL, 'r' },
+  { "window", required_argument, NULL, 'w' },
+  { "cost", required_argument, NULL, 'c' },
+  { "flush", required_argument, NULL, 'F' },
+  { "prefetch", required_argument, NULL, 'P' },
+  { "tlb", required_argument, NULL, 'T' },
+  { "huge", required_argument, NULL, 'H' },
+  { "samples", required_argument, NULL, 'k' },
+  { "seed", required_argument, NULL, 'S' },
+  { "interval", required_argument, NULL, 'i' },
   { 0, 0, 0, 0 }
 };
 
@@ -49,8 +65,20 @@ static const struct option longopts[] =
 #endif
 /**********************************************************************/
 
-static void options_handle_algorithm(const char *alg_name);
+static fault_handler_info_t *options_handle_algorithm(const char *alg_name);
+static void options_handle_algorithms(char *alg_names);
 static long options_atoi(const char *arg);
+static void options_handle_replacement(const char *arg);
+static int options_fields(const char *arg, long *fields, int max);
+static void options_handle_cost(const char *arg);
+static void options_handle_flush(const char *arg);
+static void options_handle_prefetch(const char *arg);
+static void options_handle_tlb(const char *arg);
+static void options_handle_huge(const char *arg);
+static void options_handle_samples(const char *arg);
+static void options_handle_seed(const char *arg);
+static void options_handle_interval(char *arg);
+static int options_list(const char *arg, int **list);
 static void options_print_help();
 static void options_print_version();
 static char *_longopt(char *longopt_help);
@@ -60,7 +88,7 @@ static void _algorithm_help();
 /* Process the argc/argv array, updating the global
  * options struct 'opts'. */
 void options_process(int argc, char **argv) {
-  int opt;
+  int opt, i, n, frames;
   /* Options handled within this function: */
   int help = FALSE, version = FALSE;
 
@@ -68,9 +96,37 @@ void options_process(int argc, char **argv) {
   opts.input_file = NULL;
   opts.verbose = FALSE;
   opts.test = FALSE;
+  opts.mrc = FALSE;
   opts.pagesize = 1024;
   opts.phys_pages = 128;
   opts.limit = 0;
+  opts.flat_max = PAGETABLE_FLAT_DEFAULT;
+  opts.addr_bits = ADDR_BITS_DEFAULT;
+  opts.local_frames = 0;
+  opts.ws_window = 0;
+  opts.cost = FALSE;
+  opts.page_in_ns = COST_PAGE_IN_NS;
+  opts.page_out_ns = COST_PAGE_OUT_NS;
+  opts.ref_ns = COST_REF_NS;
+  opts.flush_rate = 0;
+  opts.flush_threshold = FLUSH_THRESHOLD_DEFAULT;
+  opts.prefetch = PREFETCH_NONE;
+  opts.prefetch_pages = 0;
+  opts.tlb_levels = 0;
+  opts.huge_pagesize = 0;
+  opts.huge_promote = HUGE_PROMOTE_DEFAULT;
+  opts.sample_k = SAMPLE_K_DEFAULT;
+  opts.sample_pool = 0;
+  opts.seed = 1;
+  opts.seed_runs = 1;
+  opts.interval_every = 0;
+  opts.interval_faults = FALSE;
+  opts.interval_file = NULL;
+  opts.phys_pages_list = &opts.phys_pages;
+  opts.num_phys_pages = 1;
+  opts.pagesize_list = &opts.pagesize;
+  opts.num_pagesizes = 1;
+  opts.threads = sysconf(_SC_NPROCESSORS_ONLN);
   
   while (1) {
     opt = GETOPT(argc, argv);
@@ -96,10 +152,55 @@ void options_process(int argc, char **argv) {
       opts.test = TRUE;
       break;
     case 'p':
-      opts.phys_pages = options_atoi(optarg);
+      opts.num_phys_pages = options_list(optarg, &opts.phys_pages_list);
+      opts.phys_pages = opts.phys_pages_list[0];
       break;
     case 's':
-      opts.pagesize = options_atoi(optarg);
+      opts.num_pagesizes = options_list(optarg, &opts.pagesize_list);
+      opts.pagesize = opts.pagesize_list[0];
+      break;
+    case 'f':
+      opts.flat_max = options_atoi(optarg);
+      break;
+    case 'a':
+      opts.addr_bits = options_atoi(optarg);
+      break;
+    case 'r':
+      options_handle_replacement(optarg);
+      break;
+    case 'c':
+      options_handle_cost(optarg);
+      break;
+    case 'F':
+      options_handle_flush(optarg);
+      break;
+    case 'P':
+      options_handle_prefetch(optarg);
+      break;
+    case 'H':
+      options_handle_huge(optarg);
+      break;
+    case 'T':
+      options_handle_tlb(optarg);
+      break;
+    case 'k':
+      options_handle_samples(optarg);
+      break;
+    case 'S':
+      options_handle_seed(optarg);
+      break;
+    case 'i':
+      options_handle_interval(optarg);
+      break;
+    case 'w':
+      opts.ws_window = options_atoi(optarg);
+      if (opts.ws_window < 1) {
+	fprintf(stderr, "vmsim: the working-set window must be at least 1\n");
+	exit(1);
+      }
+      break;
+    case 'j':
+      opts.threads = options_atoi(optarg);
       break;
     case '?':
       /* Unrecognized option - print usage */
@@ -125,17 +226,55 @@ void options_process(int argc, char **argv) {
     exit(1);
   }
 
-  if (opts.phys_pages < MIN_PHYS_PAGES) {
-    fprintf(stderr, "vmsim: must have at least %d pages\n", MIN_PHYS_PAGES);
-    exit(1);
+  for (i = 0; i < opts.num_phys_pages; i++) {
+    if (opts.phys_pages_list[i] < MIN_PHYS_PAGES) {
+      fprintf(stderr, "vmsim: must have at least %d pages\n", MIN_PHYS_PAGES);
+      exit(1);
+    }
   }
 
-  if (opts.pagesize < MIN_PAGESIZE) {
-    fprintf(stderr, "vmsim: pagesize must be at least %d bytes\n", MIN_PAGESIZE);
+  if (opts.addr_bits < log_2(MIN_PAGESIZE) + 1 ||
+      opts.addr_bits > ADDR_BITS_MAX) {
+    fprintf(stderr, "vmsim: address space must be %d to %d bits\n",
+	    log_2(MIN_PAGESIZE) + 1, ADDR_BITS_MAX);
     exit(1);
   }
-  if (log_2(opts.pagesize) == -1) {
-    fprintf(stderr, "vmsim: pagesize must be a power of 2\n");
+
+  for (i = 0; i < opts.num_pagesizes; i++) {
+    if (opts.pagesize_list[i] < MIN_PAGESIZE) {
+      fprintf(stderr, "vmsim: pagesize must be at least %d bytes\n", MIN_PAGESIZE);
+      exit(1);
+    }
+    if (log_2(opts.pagesize_list[i]) == -1) {
+      fprintf(stderr, "vmsim: pagesize must be a power of 2\n");
+      exit(1);
+    }
+    if (log_2(opts.pagesize_list[i]) >= opts.addr_bits) {
+      fprintf(stderr, "vmsim: pagesize must be smaller than the %u-bit address space\n",
+	      opts.addr_bits);
+      exit(1);
+    }
+  }
+
+  if (opts.huge_pagesize) {
+    for (i = 0; i < opts.num_pagesizes; i++) {
+      if (opts.huge_pagesize <= opts.pagesize_list[i] ||
+	  log_2(opts.huge_pagesize) >= opts.addr_bits) {
+	fprintf(stderr, "vmsim: huge pages must be larger than pages and smaller than the address space\n");
+	exit(1);
+      }
+      for (n = 0; n < opts.num_phys_pages; n++) {
+	frames = opts.local_frames ? opts.local_frames : opts.phys_pages_list[n];
+	if (opts.huge_pagesize / opts.pagesize_list[i] > frames / 2) {
+	  fprintf(stderr, "vmsim: a huge page must fit in half of the frames\n");
+	  exit(1);
+	}
+      }
+    }
+  }
+
+  if (opts.threads < 1) {
+    fprintf(stderr, "vmsim: must use at least 1 thread\n");
     exit(1);
   }
 
@@ -145,7 +284,34 @@ void options_process(int argc, char **argv) {
     fprintf(stderr, "vmsim: algorithm must be specified\n");
     exit(1);
   }
-  options_handle_algorithm(argv[optind]);
+  options_handle_algorithms(argv[optind]);
+
+  opts.sweep = opts.num_fault_handlers * opts.num_phys_pages *
+    opts.num_pagesizes * opts.seed_runs > 1;
+  if (opts.sweep && opts.mrc) {
+    fprintf(stderr, "vmsim: lru-mrc cannot be part of a sweep\n");
+    exit(1);
+  }
+  if (opts.sweep && opts.interval_every) {
+    fprintf(stderr, "vmsim: interval statistics cannot be part of a sweep\n");
+    exit(1);
+  }
+  if (opts.mrc && opts.local_frames) {
+    fprintf(stderr, "vmsim: lru-mrc needs global replacement\n");
+    exit(1);
+  }
+  for (i = 0; i < opts.num_fault_handlers; i++) {
+    if (strcmp(opts.fault_handler_list[i]->name, "opt") == 0 &&
+	(opts.prefetch != PREFETCH_NONE || opts.huge_pagesize)) {
+      fprintf(stderr, "vmsim: opt cannot be combined with prefetching or huge pages\n");
+      exit(1);
+    }
+    if (strcmp(opts.fault_handler_list[i]->name, "wsclock") == 0 &&
+	opts.ws_window == 0) {
+      fprintf(stderr, "vmsim: wsclock needs a working-set window (-w)\n");
+      exit(1);
+    }
+  }
   
   if (optind+1 < argc) {
     opts.input_file = argv[optind+1];
@@ -177,8 +343,300 @@ long options_atoi(const char *arg) {
   return ret;
 }
 
-void options_handle_algorithm(const char *alg_name) {
+/* -r global, or -r local:FRAMES to give each process FRAMES frames. */
+void options_handle_replacement(const char *arg) {
+  if (strcmp(arg, "global") == 0) {
+    opts.local_frames = 0;
+  } else if (strncmp(arg, "local:", 6) == 0) {
+    opts.local_frames = options_atoi(arg + 6);
+    if (opts.local_frames < MIN_PHYS_PAGES) {
+      fprintf(stderr, "vmsim: each process must have at least %d pages\n",
+	      MIN_PHYS_PAGES);
+      exit(1);
+    }
+  } else {
+    fprintf(stderr, "vmsim: replacement must be global or local:FRAMES\n");
+    exit(1);
+  }
+}
+
+/* Parse up to max non-negative integers separated by ':' into fields,
+ * returning how many there were. */
+int options_fields(const char *arg, long *fields, int max) {
+  const char *p = arg;
+  char *end;
+  int n = 0;
+
+  while (1) {
+    if (n == max || *p < '0' || *p > '9')
+      return -1;
+    fields[n++] = strtol(p, &end, 10);
+    if (*end == '\0')
+      return n;
+    if (*end != ':')
+      return -1;
+    p = end + 1;
+  }
+}
+
+/* -c IN:OUT[:REF], the page-in, page-out and per-reference latencies. */
+void options_handle_cost(const char *arg) {
+  long fields[3];
+  int n = options_fields(arg, fields, 3);
+
+  if (n < 2) {
+    fprintf(stderr, "vmsim: cost must be IN:OUT[:REF] latencies in ns\n");
+    exit(1);
+  }
+  opts.cost = TRUE;
+  opts.page_in_ns = fields[0];
+  opts.page_out_ns = fields[1];
+  if (n == 3)
+    opts.ref_ns = fields[2];
+}
+
+/* -F RATE[:THRESHOLD], the background flusher. */
+void options_handle_flush(const char *arg) {
+  long fields[2];
+  int n = options_fields(arg, fields, 2);
+
+  if (n < 1 || fields[0] == 0 || (n == 2 && fields[1] > 100)) {
+    fprintf(stderr, "vmsim: flush must be RATE[:THRESHOLD], RATE > 0 pages per %d references and THRESHOLD a percentage\n",
+	    WRITEBACK_PERIOD);
+    exit(1);
+  }
+  opts.cost = TRUE;
+  opts.flush_rate = fields[0];
+  if (n == 2)
+    opts.flush_threshold = fields[1];
+}
+
+/* -P none, next:N, stride:N or adaptive[:MAX]. */
+void options_handle_prefetch(const char *arg) {
+  const char *colon = strchr(arg, ':');
+  size_t len = colon ? colon - arg : strlen(arg);
+
+  opts.prefetch_pages = colon ? options_atoi(colon + 1) : 0;
+  if (len == 4 && strncmp(arg, "none", len) == 0 && !colon) {
+    opts.prefetch = PREFETCH_NONE;
+  } else if (len == 4 && strncmp(arg, "next", len) == 0 && colon) {
+    opts.prefetch = PREFETCH_NEXT;
+  } else if (len == 6 && strncmp(arg, "stride", len) == 0 && colon) {
+    opts.prefetch = PREFETCH_STRIDE;
+  } else if (len == 8 && strncmp(arg, "adaptive", len) == 0) {
+    opts.prefetch = PREFETCH_ADAPTIVE;
+    if (!colon)
+      opts.prefetch_pages = PREFETCH_ADAPTIVE_MAX;
+  } else {
+    fprintf(stderr, "vmsim: prefetch must be none, next:N, stride:N or adaptive[:MAX]\n");
+    exit(1);
+  }
+  if (opts.prefetch != PREFETCH_NONE && opts.prefetch_pages < 1) {
+    fprintf(stderr, "vmsim: prefetch needs at least 1 page\n");
+    exit(1);
+  }
+}
+
+/* -H SIZE[:PROMOTE], huge pages of SIZE bytes. */
+void options_handle_huge(const char *arg) {
+  long fields[2];
+  int n = options_fields(arg, fields, 2);
+
+  if (n < 1 || log_2(fields[0]) == -1 || (n == 2 && fields[1] > 100)) {
+    fprintf(stderr, "vmsim: huge pages must be SIZE[:PROMOTE], a power of 2 and a percentage\n");
+    exit(1);
+  }
+  opts.huge_pagesize = fields[0];
+  opts.huge_promote = n == 2 ? fields[1] : HUGE_PROMOTE_DEFAULT;
+}
+
+/* -k SAMPLES[:POOL], for sampled-lru. */
+void options_handle_samples(const char *arg) {
+  long fields[2];
+  int n = options_fields(arg, fields, 2);
+
+  if (n < 1 || fields[0] < 1) {
+    fprintf(stderr, "vmsim: samples must be SAMPLES[:POOL], SAMPLES > 0\n");
+    exit(1);
+  }
+  opts.sample_k = fields[0];
+  opts.sample_pool = n == 2 ? fields[1] : 0;
+}
+
+/* -S SEED[:RUNS]. */
+void options_handle_seed(const char *arg) {
+  long fields[2];
+  int n = options_fields(arg, fields, 2);
+
+  if (n < 1 || (n == 2 && fields[1] < 1)) {
+    fprintf(stderr, "vmsim: seed must be SEED[:RUNS], RUNS > 0\n");
+    exit(1);
+  }
+  opts.seed = fields[0];
+  opts.seed_runs = n == 2 ? fields[1] : 1;
+}
+
+/* -i N[f][:FILE], interval statistics every N references or faults. */
+void options_handle_interval(char *arg) {
+  char *end;
+  long n = strtol(arg, &end, 10);
+
+  opts.interval_faults = *end == 'f';
+  if (opts.interval_faults)
+    end++;
+  if (end == arg || n < 1 || (*end != '\0' && (*end != ':' || end[1] == '\0'))) {
+    fprintf(stderr, "vmsim: interval must be N[f][:FILE], N > 0\n");
+    exit(1);
+  }
+  opts.interval_every = n;
+  opts.interval_file = *end == ':' ? end + 1 : NULL;
+}
+
+/* -T ENTRIES[:WAYS[:POLICY]][,ENTRIES[:WAYS[:POLICY]]], the TLB levels.
+ * WAYS defaults to ENTRIES (fully associative), POLICY to lru. */
+void options_handle_tlb(const char *arg) {
+  static const char *policies[] = { "lru", "fifo", "random" };
+  char *copy, *level, *save, *name;
+  tlb_opts_t *t;
+  long fields[2];
+  int n, i;
+
+  copy = strdup(arg);
+  assert(copy);
+  opts.tlb_levels = 0;
+  for (level = strtok_r(copy, ",", &save); level;
+       level = strtok_r(NULL, ",", &save)) {
+    if (opts.tlb_levels == TLB_MAX_LEVELS) {
+      fprintf(stderr, "vmsim: the TLB has at most %d levels\n", TLB_MAX_LEVELS);
+      exit(1);
+    }
+    t = &opts.tlb[opts.tlb_levels++];
+    t->policy = TLB_LRU;
+    name = strrchr(level, ':');
+    if (name && (name[1] < '0' || name[1] > '9')) {
+      *name++ = '\0';
+      for (i = 0; i < 3 && strcmp(name, policies[i]) != 0; i++)
+	;
+      if (i == 3) {
+	fprintf(stderr, "vmsim: TLB policy must be lru, fifo or random\n");
+	exit(1);
+      }
+      t->policy = (tlb_policy_t)i;
+    }
+    n = options_fields(level, fields, 2);
+    if (n < 1 || fields[0] < 1 || (n == 2 && fields[1] < 1)) {
+      fprintf(stderr, "vmsim: TLB levels must be ENTRIES[:WAYS[:POLICY]]\n");
+      exit(1);
+    }
+    t->entries = fields[0];
+    t->ways = n == 2 ? fields[1] : fields[0];
+    if (t->entries % t->ways != 0 || log_2(t->entries / t->ways) == -1) {
+      fprintf(stderr, "vmsim: TLB entries / ways must be a power of 2\n");
+      exit(1);
+    }
+  }
+  if (opts.tlb_levels == 0) {
+    fprintf(stderr, "vmsim: TLB levels must be ENTRIES[:WAYS[:POLICY]]\n");
+    exit(1);
+  }
+  free(copy);
+}
+
+/* Parse a list of values for -p or -s into a new array, returning its
+ * length. The list is comma separated; each item is either a number N,
+ * or a range START:END[:xFACTOR|:+STEP] that steps geometrically (x2 if
+ * no step is given) or arithmetically from START up to at most END. */
+int options_list(const char *arg, int **list) {
+  char *copy, *item, *save, *field, *end;
+  long start, stop, step;
+  bool_t geometric;
+  int num = 0, capacity = 16;
+
+  *list = (int*)malloc(capacity * sizeof(int));
+  copy = strdup(arg);
+  assert(*list && copy);
+
+  for (item = strtok_r(copy, ",", &save); item;
+       item = strtok_r(NULL, ",", &save)) {
+    start = stop = strtol(item, &end, 10);
+    step = 2;
+    geometric = TRUE;
+    if (*end == ':') {
+      field = end + 1;
+      stop = strtol(field, &end, 10);
+      if (end == field)
+	goto invalid;
+      if (*end == ':') {
+	field = end + 1;
+	if (*field == 'x')
+	  geometric = TRUE;
+	else if (*field == '+')
+	  geometric = FALSE;
+	else
+	  goto invalid;
+	step = strtol(field + 1, &end, 10);
+	if (end == field + 1 || step < (geometric ? 2 : 1))
+	  goto invalid;
+      }
+    }
+    if (end == item || *end != '\0' || start <= 0 || stop < start)
+      goto invalid;
+
+    while (start <= stop) {
+      if (num == capacity) {
+	capacity *= 2;
+	*list = (int*)realloc(*list, capacity * sizeof(int));
+	assert(*list);
+      }
+      (*list)[num++] = start;
+      start = geometric ? start * step : start + step;
+    }
+  }
+  if (num == 0)
+    goto invalid;
+  free(copy);
+  return num;
+
+ invalid:
+  fprintf(stderr, "vmsim: invalid value or range: %s\n", arg);
+  exit(1);
+}
+
+/* Look up each name in a comma separated list of algorithms. */
+void options_handle_algorithms(char *alg_names) {
+  char *name, *save;
+  int capacity = 0;
+
+  opts.num_fault_handlers = 0;
+  opts.fault_handler_list = NULL;
+  for (name = strtok_r(alg_names, ",", &save); name;
+       name = strtok_r(NULL, ",", &save)) {
+    if (opts.num_fault_handlers == capacity) {
+      capacity = capacity ? 2 * capacity : 8;
+      opts.fault_handler_list = (fault_handler_info_t**)
+	realloc(opts.fault_handler_list, capacity * sizeof(fault_handler_info_t*));
+      assert(opts.fault_handler_list);
+    }
+    opts.fault_handler_list[opts.num_fault_handlers++] =
+      options_handle_algorithm(name);
+  }
+  if (opts.num_fault_handlers == 0) {
+    fprintf(stderr, "vmsim: algorithm must be specified\n");
+    exit(1);
+  }
+  opts.fault_handler = opts.fault_handler_list[0];
+}
+
+fault_handler_info_t *options_handle_algorithm(const char *alg_name) {
   fault_handler_info_t *alg;
+
+  /* lru-mrc simulates lru at the requested size and computes the miss
+   * ratio curve for every other size in the same pass. */
+  if (strcmp(alg_name, "lru-mrc") == 0) {
+    opts.mrc = TRUE;
+    alg_name = "lru";
+  }
+
   for (alg = fault_handlers; alg->name != NULL; alg++) {
     if (strcmp(alg->name, alg_name) == 0) {
       break;
@@ -190,7 +648,7 @@ void options_handle_algorithm(const char *alg_name) {
   } else if (opts.verbose) {
     printf("vmsim: using replacement algorithm '%s'\n", alg_name);
   }
-  opts.fault_handler = alg;
+  return alg;
 }
 
 void options_print_version() {
@@ -200,13 +658,20 @@ void options_print_version() {
 }
 
 void options_print_help() {
-  printf("Usage: vmsim [OPTIONS] ALGORITHM [TRACEFILE|-]\n");
+  printf("Usage: vmsim [OPTIONS] ALGORITHM[,ALGORITHM...] [TRACEFILE|-]\n");
   printf("Process TRACEFILE, simulating a VM system. Reports stats on paging behavior.\n");
   printf("If TRACEFILE is not specified or is '-', input will be taken from stdin.\n");
+  printf("TRACEFILE may be a text trace or a binary trace made by vmsim-convert.\n");
   printf("\n");
   printf("ALGORITHM specifies the fault handler, and should be one of:\n");
   _algorithm_help();
   printf("\n");
+  printf("Giving several algorithms, a list or range of PAGES or SIZE, or several\n");
+  printf("seeds (-S) runs a sweep: the trace is parsed once, every combination is\n");
+  printf("simulated on a pool of threads, and the results are printed as CSV.\n");
+  printf("Lists are comma separated; a range START:END[:xFACTOR|:+STEP] counts\n");
+  printf("from START up to END, doubling if no step is given (e.g. -p 64:65536:x2).\n");
+  printf("\n");
   printf("Options:\n");
   printf("-h%s               Print this message and exit.\n", _longopt("|--help"));
   printf("-V%s            Print the version information.\n", _longopt("|--version"));
@@ -218,6 +683,46 @@ void options_print_help() {
   printf("                        Minimum value %d.\n", MIN_PHYS_PAGES);
   printf("-s SIZE%s     Simulate a page size of SIZE bytes.\n", _longopt("|--size=SIZE"));  
   printf("                        Size must be a power of 2.\n");
+  printf("-f PAGES%s   Use a flat page table if the virtual address space\n", _longopt("|--flat=PAGES"));
+  printf("                        has at most PAGES pages (default %d, 0 never).\n", PAGETABLE_FLAT_DEFAULT);
+  printf("-a BITS%s Simulate a BITS-bit virtual address space\n", _longopt("|--addr-bits=BITS"));
+  printf("                        (default %d, at most %d). Higher address bits\n", ADDR_BITS_DEFAULT, ADDR_BITS_MAX);
+  printf("                        are ignored; use 32, 48 or 64 for real traces.\n");
+  printf("-r POLICY%s Replace pages globally (POLICY global, the\n", _longopt("|--replacement=POLICY"));
+  printf("                        default), or within each process (local:FRAMES).\n");
+  printf("                        Each trace pid has its own address space; local\n");
+  printf("                        replacement gives each FRAMES of the PAGES.\n");
+  printf("-w WINDOW%s   Report the working-set size over time, counting\n", _longopt("|--window=REFS"));
+  printf("                        pages used in the last WINDOW references. Also\n");
+  printf("                        the window of wsclock.\n");
+  printf("-c IN:OUT[:REF]%s Report stall time and write-back bandwidth,\n", _longopt("|--cost=IN:OUT[:REF]"));
+  printf("                        taking IN ns per page in, OUT ns per dirty page\n");
+  printf("                        evicted and REF ns per reference (default\n");
+  printf("                        %d:%d:%d).\n", COST_PAGE_IN_NS, COST_PAGE_OUT_NS, COST_REF_NS);
+  printf("-F RATE[:PCT]%s Run a flusher writing back up to RATE dirty pages\n", _longopt("|--flush=RATE[:PCT]"));
+  printf("                        per %d references while over PCT%% of the frames\n", WRITEBACK_PERIOD);
+  printf("                        are dirty (default %d). Implies -c.\n", FLUSH_THRESHOLD_DEFAULT);
+  printf("-P POLICY%s Prefetch on faults: next:N pages, stride:N pages\n", _longopt("|--prefetch=POLICY"));
+  printf("                        at a detected stride, or adaptive[:MAX] readahead\n");
+  printf("                        (up to %d pages). Default none.\n", PREFETCH_ADAPTIVE_MAX);
+  printf("-H SIZE[:PCT]%s Use huge pages of SIZE bytes, promoting a region\n", _longopt("|--huge=SIZE[:PCT]"));
+  printf("                        once PCT%% of it is resident (default %d).\n", HUGE_PROMOTE_DEFAULT);
+  printf("-T L1[,L2]%s Look up pages in a TLB of one or two levels,\n", _longopt("|--tlb=L1[,L2]"));
+  printf("                        each ENTRIES[:WAYS[:lru|fifo|random]]; fully\n");
+  printf("                        associative lru by default.\n");
+  printf("-k K[:POOL]%s sampled-lru evicts the oldest of K frames\n", _longopt("|--samples=K[:POOL]"));
+  printf("                        sampled at random (default %d), keeping the\n", SAMPLE_K_DEFAULT);
+  printf("                        POOL oldest candidates between faults.\n");
+  printf("-S SEED[:RUNS]%s Seed the random choices of random,\n", _longopt("|--seed=SEED[:RUNS]"));
+  printf("                        sampled-lru and random TLBs (default 1). RUNS\n");
+  printf("                        sweeps seeds SEED to SEED + RUNS - 1, giving the\n");
+  printf("                        mean fault rate and its 95%% confidence interval.\n");
+  printf("-i N[f][:FILE]%s Every N references (N faults with f), write\n", _longopt("|--interval=N[f][:FILE]"));
+  printf("                        a row of that interval's statistics to FILE or\n");
+  printf("                        stdout: CSV, or JSON Lines if FILE ends in .json\n");
+  printf("                        or .jsonl.\n");
+  printf("-j THREADS%s Run a sweep on THREADS threads.\n", _longopt("|--threads=N"));
+  printf("                        Defaults to the number of CPUs.\n");
   
 }
 
@@ -234,8 +739,9 @@ void _algorithm_help() {
   fault_handler_info_t *alg;
   printf("   ");
   for (alg = fault_handlers; alg->name != NULL; alg++) {
-    printf("%s%s", alg->name, (alg+1)->name ? ", " : "\n");
+    printf("%s, ", alg->name);
   }
+  printf("lru-mrc\n");
 }
 
 /* Helper function to handle help for case where we don't support GNU-style
@@ -4,15 +4,74 @@
 #include <vmsim.h>
 #include <fault.h>
 
+#define MIN_PHYS_PAGES 3
+
+/* Default latencies of the write-back cost model, in ns. */
+#define COST_PAGE_IN_NS 100000
+#define COST_PAGE_OUT_NS 100000
+#define COST_REF_NS 100
+#define FLUSH_THRESHOLD_DEFAULT 10
+
+/* -k: frames sampled per fault by sampled-lru, as Redis defaults to. */
+#define SAMPLE_K_DEFAULT 5
+
+/* -P: prefetch policies; see prefetch.h. */
+typedef enum _prefetch_policy {
+  PREFETCH_NONE, PREFETCH_NEXT, PREFETCH_STRIDE, PREFETCH_ADAPTIVE
+} prefetch_policy_t;
+
+/* -T: the TLB; see tlb.h. */
+#define TLB_MAX_LEVELS 2
+typedef enum _tlb_policy { TLB_LRU, TLB_FIFO, TLB_RANDOM } tlb_policy_t;
+typedef struct _tlb_opts {
+  uint entries;
+  uint ways; /* entries / ways sets, a power of 2 */
+  tlb_policy_t policy;
+} tlb_opts_t;
+
 typedef struct _opts {
   bool_t verbose;
   bool_t test;
+  bool_t mrc; /* lru-mrc: also compute the LRU miss ratio curve */
   int pagesize;
   int phys_pages;
   long limit;
+  uint flat_max; /* largest virtual page space given a flat page table */
+  uint addr_bits; /* width of a virtual address */
+  int local_frames; /* local replacement: frames per process; 0 for global */
+  uint ws_window; /* working-set window in references (-w); 0 if none */
+  bool_t cost; /* report simulated stall time and write-back bandwidth */
+  ulong page_in_ns, page_out_ns, ref_ns; /* -c latencies */
+  uint flush_rate; /* -F: flusher pages per WRITEBACK_PERIOD refs; 0 for none */
+  uint flush_threshold; /* -F: percent of frames dirty before it writes */
+  prefetch_policy_t prefetch; /* -P policy */
+  uint prefetch_pages; /* -P: N, or MAX for adaptive */
+  int tlb_levels; /* -T: 0 for no TLB */
+  tlb_opts_t tlb[TLB_MAX_LEVELS];
+  uint huge_pagesize; /* -H: bytes, 0 for no huge pages */
+  uint huge_promote; /* -H: percent of a region resident to promote it */
+  uint sample_k; /* -k: frames sampled per fault by sampled-lru */
+  uint sample_pool; /* -k: sampled-lru eviction pool size; 0 for none */
+  unsigned long long seed; /* -S: seeds every random number generator */
+  int seed_runs; /* -S: runs with seeds seed, seed + 1, ...; > 1 sweeps */
+  uint interval_every; /* -i: references (or faults) per row; 0 for none */
+  bool_t interval_faults; /* -i: interval_every counts faults */
+  char *interval_file; /* -i: where rows go, NULL for stdout */
   char *output_file;
   char *input_file;
   fault_handler_info_t *fault_handler;
+
+  /* Sweep mode: every combination of these lists is simulated over one
+   * parsed trace. fault_handler, phys_pages and pagesize above hold the
+   * first entry of each, which is all a single simulation uses. */
+  bool_t sweep;
+  int threads;
+  fault_handler_info_t **fault_handler_list;
+  int num_fault_handlers;
+  int *phys_pages_list;
+  int num_phys_pages;
+  int *pagesize_list;
+  int num_pagesizes;
 } opts_t;
 
 extern opts_t opts;
@@ -3,11 +3,14 @@
  *               lookup the pte_t and discover whether it is in memory or not.
  *               Surprisingly, the 2-level table and an optimized 1-level
  *               table seem to have the same performance.
+ *               Address spaces too wide for the levels (48 and 64-bit
+ *               traces) use a hash table of the pages actually touched.
  *
  */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 
 #include <vmsim.h>
@@ -15,53 +18,87 @@
 #include <options.h>
 #include <pagetable.h>
 #include <stats.h>
-
-typedef struct _pagetable_level {
-  uint size;
-  uint log_size;
-  bool_t is_leaf;
-} pagetable_level_t;
+#include <proc.h>
+#include <sim.h>
 
 /* Define a multi-level page table.
  * This is defines the largest each level can be.
  * pagetable_init may opt to reduce the sizes,
  * if less bits are needed (because pagesize is larger). */
-pagetable_level_t levels[3] = {
+static const pagetable_level_t default_levels[PAGETABLE_MAX_LEVELS] = {
   { 4096, 12, FALSE }, /*levels[0] has 12 bits. If vfn_bits exceeds 12, then need additional levels*/
   { 4096, 12, FALSE }, /*levels[1] has 12 bits. If vfn_bits exceeds 24, then need additional levels*/
   { 256, 8, TRUE } /*levels[2] has 8 bits. So the maximum vfn_bits that can be handled is 12+12+8=32*/ 
 };
 
-/* vfn_bits is number of bits in the virtual frame number *
- * vfn_bits should be sum of log_size fields of all levels */
-uint vfn_bits;
-
-/* Structure representing our multi-level pagetable */
-typedef struct _pagetable {
-  void **table; /* If lowest-level, array of pte_t pointers;
-		  * otherwise array of pagetable_t pointers. */
-  int level;
-} pagetable_t;
-
-/*root_table->table is the current page table. Use pte_t *pte=(pte_t *) root_table->table[i] to access each pte entry*/
-static pagetable_t *root_table; ; 
-
-pte_t *pagetable_lookup_helper(uint vfn, uint bits, uint masked_vfn,
-			       pagetable_t *pages, ref_kind_t type);
-pte_t *pagetable_new_pte(uint vfn);
-pagetable_t *pagetable_new_table(int level);
+pte_t *pagetable_lookup_helper(sim_t *sim, pagetable_t *pt, uint vfn,
+			       uint bits, uint masked_vfn,
+			       pagetable_node_t *pages, ref_kind_t type);
+pte_t *pagetable_new_pte(pagetable_t *pt, vfn_t vfn);
+static void pagetable_init_pte(pagetable_t *pt, pte_t *pte, vfn_t vfn);
+static pte_t *pagetable_lookup_flat(sim_t *sim, pagetable_t *pt, uint vfn,
+				    ref_kind_t type);
+static pte_t *pagetable_lookup_hash(sim_t *sim, pagetable_t *pt, vfn_t vfn,
+				    ref_kind_t type);
+static void pagetable_hash_grow(pagetable_t *pt);
+pagetable_node_t *pagetable_new_table(pagetable_t *pt, int level);
 inline uint getbits(uint x, int p, int n);
-void pagetable_test_entry(uint vfn, int l1, int l2);
+void pagetable_test_entry(sim_t *sim, pagetable_t *pt, uint vfn, int l1,
+			  int l2);
+
+/* Initial size of a hashed table, as a power of 2. */
+#define PAGETABLE_HASH_MIN_BITS 10
 
-void pagetable_init() {
+pagetable_t *pagetable_new(sim_t *sim, proc_t *proc) {
+  pagetable_t *pt;
+  pagetable_level_t *levels;
+  uint vfn_bits;
   int level;
   uint page_bits, bits;
-  page_bits = log_2(opts.pagesize);
+
+  pt = (pagetable_t*)malloc(sizeof(pagetable_t));
+  assert(pt);
+  pt->proc = proc;
+  levels = pt->levels;
+  memcpy(levels, default_levels, sizeof(default_levels));
+  arena_init(&pt->arena);
+
+  page_bits = log_2(sim->opts.pagesize);
   if (page_bits == -1) {
     fprintf(stderr, "vmsim: Pagesize must be a power of 2\n");
     abort();
   }
-  vfn_bits = addr_space_bits - page_bits;
+  pt->addr_bits = sim->opts.addr_bits;
+  pt->page_bits = page_bits;
+  pt->vaddr_mask = pt->addr_bits < ADDR_BITS_MAX ?
+    ((vaddr_t)1 << pt->addr_bits) - 1 : ~(vaddr_t)0;
+  vfn_bits = pt->vfn_bits = pt->addr_bits - page_bits;
+
+  /* Small virtual page spaces get one contiguous array of pte_t. */
+  pt->flat = NULL;
+  pt->flat_seen = NULL;
+  pt->root = NULL;
+  pt->hash = NULL;
+  pt->walk_levels = 1;
+  if (vfn_bits < 32 && pow_2(vfn_bits) <= sim->opts.flat_max) {
+    pt->flat = (pte_t*)arena_alloc(&pt->arena, pow_2(vfn_bits) * sizeof(pte_t));
+    pt->flat_seen = (byte_t*)arena_calloc(&pt->arena, pow_2(vfn_bits),
+					  sizeof(byte_t));
+    if (sim->opts.test)
+      printf("vmsim: vfn_bits %d, flat table (%u entries)\n", vfn_bits,
+	     pow_2(vfn_bits));
+    return pt;
+  }
+
+  if (vfn_bits > PAGETABLE_RADIX_MAX_BITS) {
+    pt->hash_bits = PAGETABLE_HASH_MIN_BITS;
+    pt->hash_size = 0;
+    pt->hash = (pte_t**)calloc((size_t)1 << pt->hash_bits, sizeof(pte_t*));
+    assert(pt->hash);
+    if (sim->opts.test)
+      printf("vmsim: vfn_bits %d, hashed table\n", vfn_bits);
+    return pt;
+  }
 
   bits = 0;
   level = 0;
@@ -75,8 +112,9 @@ void pagetable_init() {
   levels[level].log_size = levels[level].log_size - (bits - vfn_bits);
   levels[level].size = pow_2(levels[level].log_size);
   levels[level].is_leaf = TRUE;
+  pt->walk_levels = level + 1;
   
-  if (opts.test) {
+  if (sim->opts.test) {
     int i;
     printf("vmsim: vfn_bits %d, %d level table\n", vfn_bits, level+1);
     for (i=0; i<=level; i++) {
@@ -85,28 +123,115 @@ void pagetable_init() {
     }
   }
   
-  root_table = pagetable_new_table(0);
+  pt->root = pagetable_new_table(pt, 0);
+  return pt;
+}
+
+/* Release every level and pte_t of the page table. They all live in the
+ * arena, so there is no need to walk the table. */
+void pagetable_free(pagetable_t *pt) {
+  free(pt->hash);
+  arena_release(&pt->arena);
+  free(pt);
 }
 
-pagetable_t *pagetable_new_table(int level) {
-  pagetable_t *table;
+pagetable_node_t *pagetable_new_table(pagetable_t *pt, int level) {
+  pagetable_node_t *table;
   pagetable_level_t *config;
-  config = &levels[level];
+  config = &pt->levels[level];
   assert(config);
   
-  table = malloc(sizeof(struct _pagetable));
-  assert(table);
-
-  table->table = calloc(config->size, sizeof(void*));
-  assert(table->table);
+  table = arena_alloc(&pt->arena, sizeof(pagetable_node_t));
+  table->table = arena_calloc(&pt->arena, config->size, sizeof(void*));
 
   table->level = level;
 
   return table;
 }
 
-pte_t *pagetable_lookup_vaddr(uint vfn, ref_kind_t type) {
-  return pagetable_lookup_helper(vfn, 0, vfn, root_table, type);
+pte_t *pagetable_lookup_vaddr(sim_t *sim, pagetable_t *pt, vfn_t vfn,
+			      ref_kind_t type) {
+  if (pt->flat)
+    return pagetable_lookup_flat(sim, pt, (uint)vfn, type);
+  if (pt->hash)
+    return pagetable_lookup_hash(sim, pt, vfn, type);
+  return pagetable_lookup_helper(sim, pt, (uint)vfn, 0, (uint)vfn, pt->root,
+				 type);
+}
+
+/* Count a compulsory miss on new page pte, both overall and for the owning
+ * process. A page the prefetcher brings in is counted by sim_reference
+ * instead, if its first reference misses. */
+static inline void pagetable_compulsory(sim_t *sim, pagetable_t *pt,
+					pte_t *pte, ref_kind_t type) {
+  if (type == REF_KIND_PREFETCH) {
+    pte->untouched = TRUE;
+    return;
+  }
+  stats_compulsory(sim->stats, type);
+  stats_compulsory(&pt->proc->stats, type);
+}
+
+/* Flat table lookup. pagetable_lookup inlines the common case, a page seen
+ * before; this also handles the first touch. */
+pte_t *pagetable_lookup_flat(sim_t *sim, pagetable_t *pt, uint vfn,
+			     ref_kind_t type) {
+  pte_t *pte = &pt->flat[vfn];
+
+  if (!pt->flat_seen[vfn]) {
+    /* Compulsory miss - first access */
+    pagetable_init_pte(pt, pte, vfn);
+    pagetable_compulsory(sim, pt, pte, type);
+    pt->flat_seen[vfn] = TRUE;
+  }
+  return pte;
+}
+
+/* Fibonacci hashing: the top bits of vfn times 2^64/phi. */
+static inline size_t pagetable_hash(vfn_t vfn, uint bits) {
+  return (size_t)((vfn * 0x9e3779b97f4a7c15ULL) >> (64 - bits));
+}
+
+/* Hashed table lookup; creates the pte_t if vfn has not been seen. */
+pte_t *pagetable_lookup_hash(sim_t *sim, pagetable_t *pt, vfn_t vfn,
+			     ref_kind_t type) {
+  size_t mask = ((size_t)1 << pt->hash_bits) - 1;
+  size_t i = pagetable_hash(vfn, pt->hash_bits);
+  pte_t *pte;
+
+  while ((pte = pt->hash[i]) != NULL) {
+    if (pte->vfn == vfn)
+      return pte;
+    i = (i + 1) & mask;
+  }
+
+  /* Compulsory miss - first access */
+  pte = pt->hash[i] = pagetable_new_pte(pt, vfn);
+  pagetable_compulsory(sim, pt, pte, type);
+  /* Keep the table at most half full so probe sequences stay short. */
+  if (++pt->hash_size > mask / 2)
+    pagetable_hash_grow(pt);
+  return pte;
+}
+
+/* Double the hash table and reinsert every pte_t. */
+void pagetable_hash_grow(pagetable_t *pt) {
+  pte_t **old = pt->hash;
+  size_t n, i, mask, old_slots = (size_t)1 << pt->hash_bits;
+
+  pt->hash_bits++;
+  mask = ((size_t)1 << pt->hash_bits) - 1;
+  pt->hash = (pte_t**)calloc(mask + 1, sizeof(pte_t*));
+  assert(pt->hash);
+  for (n = 0; n < old_slots; n++) {
+    if (old[n] == NULL)
+      continue;
+    i = pagetable_hash(old[n]->vfn, pt->hash_bits);
+    while (pt->hash[i] != NULL)
+      i = (i + 1) & mask;
+    pt->hash[i] = old[n];
+  }
+  free(old);
 }
 
 /* Recursively search the pagetables. Creates any entries (either
@@ -119,12 +244,14 @@ pte_t *pagetable_lookup_vaddr(uint vfn, ref_kind_t type) {
  * pages - The pagetable for this level.
  * For a single-level page table, index=masked_vfn=vfn. getbits() simply returns its 1st argument.
  */
-pte_t *pagetable_lookup_helper(uint vfn, uint bits, uint masked_vfn,
-			       pagetable_t *pages, ref_kind_t type) {
+pte_t *pagetable_lookup_helper(sim_t *sim, pagetable_t *pt, uint vfn,
+			       uint bits, uint masked_vfn,
+			       pagetable_node_t *pages, ref_kind_t type) {
+  uint vfn_bits = pt->vfn_bits;
   uint index;
   int log_size;
 
-  log_size = levels[pages->level].log_size;
+  log_size = pt->levels[pages->level].log_size;
 
   index = getbits(masked_vfn, vfn_bits - (1+bits), log_size);
 #ifdef DEBUG
@@ -138,66 +265,133 @@ pte_t *pagetable_lookup_helper(uint vfn, uint bits, uint masked_vfn,
 	//index, masked_vfn, vfn_bits, bits, log_size);
 #endif
   
-  if (levels[pages->level].is_leaf) {
+  if (pt->levels[pages->level].is_leaf) {
     if (pages->table[index] == NULL) {
       /* Compulsory miss - first access */
-      stats_compulsory(type);
-      pages->table[index] = (void*)pagetable_new_pte(vfn);
+      pages->table[index] = (void*)pagetable_new_pte(pt, vfn);
+      pagetable_compulsory(sim, pt, (pte_t*)pages->table[index], type);
     }
     return (pte_t*)(pages->table[index]);
   } else {
     if (pages->table[index] == NULL) {
-      pages->table[index] = pagetable_new_table(pages->level+1);
+      pages->table[index] = pagetable_new_table(pt, pages->level+1);
     }
-    return pagetable_lookup_helper(vfn, bits, masked_vfn, pages->table[index],
-				   type);
+    return pagetable_lookup_helper(sim, pt, vfn, bits, masked_vfn,
+				   pages->table[index], type);
   }
 }
 
-pte_t *pagetable_new_pte(uint vfn) {
+pte_t *pagetable_new_pte(pagetable_t *pt, vfn_t vfn) {
   pte_t *pte;
-  pte = (pte_t*)(malloc(sizeof(pte_t)));
-  assert(pte);
+  pte = (pte_t*)arena_alloc(&pt->arena, sizeof(pte_t));
+  pagetable_init_pte(pt, pte, vfn);
+  return pte;
+}
 
+void pagetable_init_pte(pagetable_t *pt, pte_t *pte, vfn_t vfn) {
   pte->vfn = vfn;
+  pte->proc = pt->proc;
   pte->pfn = -1;
   pte->valid = FALSE;
   pte->modified = FALSE;
   pte->reference = 0;
-
-  return pte;
+  pte->counter = PTE_NEVER_USED;
+  pte->c = 0;
+  pte->lru.prev = pte->lru.next = NULL;
+  pte->aux.prev = pte->aux.next = NULL;
+  pte->dirty.prev = pte->dirty.next = NULL;
+  pte->queue = 0;
+  pte->mrc_time = 0;
+  pte->prefetched = 0;
+  pte->untouched = FALSE;
+  pte->huge = FALSE;
+  pte->filled = FALSE;
 }
 
 void pagetable_test() {
+  opts_t config = opts;
+  sim_t *sim;
+  pagetable_t *pt;
+  pte_t *pte;
+  uint vfn_bits;
+
   printf("Testing pagetables\n");
-  pagetable_init();
-  assert(root_table);
+  config.flat_max = 0;
+  sim = sim_new(&config);
+  pt = proc_lookup(sim, &sim->procs, 0)->pagetable;
+  assert(pt && pt->root);
+  vfn_bits = pt->vfn_bits;
 
   if (vfn_bits == 22) {
-    pagetable_test_entry(0, 0, 0);
-    pagetable_test_entry(1023, 0, 1023);
-    pagetable_test_entry(1024, 1, 0);
-    pagetable_test_entry((1 << vfn_bits) - 1, levels[0].size-1, levels[1].size-1);
-    pagetable_test_entry((1 << vfn_bits) - 2, levels[0].size-1, levels[1].size-2);
-    pagetable_test_entry((1 << vfn_bits) - 1024, levels[0].size-1, 0);
-    pagetable_test_entry((1 << vfn_bits) - 1025, levels[0].size-2, levels[1].size-1);
+    pagetable_test_entry(sim, pt, 0, 0, 0);
+    pagetable_test_entry(sim, pt, 1023, 0, 1023);
+    pagetable_test_entry(sim, pt, 1024, 1, 0);
+    pagetable_test_entry(sim, pt, (1 << vfn_bits) - 1, pt->levels[0].size-1, pt->levels[1].size-1);
+    pagetable_test_entry(sim, pt, (1 << vfn_bits) - 2, pt->levels[0].size-1, pt->levels[1].size-2);
+    pagetable_test_entry(sim, pt, (1 << vfn_bits) - 1024, pt->levels[0].size-1, 0);
+    pagetable_test_entry(sim, pt, (1 << vfn_bits) - 1025, pt->levels[0].size-2, pt->levels[1].size-1);
+  }
+  assert(pagetable_bytes(pt) > 0 && pt->arena.reserved >= pagetable_bytes(pt));
+  sim_free(sim);
+
+  printf("Testing flat pagetables\n");
+  config.flat_max = (uint)-1;
+  sim = sim_new(&config);
+  pt = proc_lookup(sim, &sim->procs, 0)->pagetable;
+  assert(pt && pt->flat && !pt->root);
+  vfn_bits = pt->vfn_bits;
+  pte = pagetable_lookup(sim, pt, 5, REF_KIND_LOAD);
+  assert(pte && pte->vfn == 5 && !pte->valid);
+  assert(pagetable_lookup(sim, pt, 5, REF_KIND_LOAD) == pte);
+  pte = pagetable_lookup(sim, pt, (1 << vfn_bits) - 1, REF_KIND_STORE);
+  assert(pte && pte->vfn == (1 << vfn_bits) - 1);
+  assert(sim->stats->compulsory[REF_KIND_LOAD] == 1);
+  assert(sim->stats->compulsory[REF_KIND_STORE] == 1);
+  sim_free(sim);
+
+  printf("Testing hashed pagetables\n");
+  config.addr_bits = 64;
+  config.pagesize = 4096;
+  sim = sim_new(&config);
+  pt = proc_lookup(sim, &sim->procs, 0)->pagetable;
+  assert(pt && pt->hash && !pt->root && !pt->flat && pt->vfn_bits == 52);
+  {
+    vfn_t vfn, top = ((vfn_t)1 << 52) - 1;
+    /* vfns differing only in their high bits must not alias, and enough
+     * of them force the table to grow a few times */
+    for (vfn = 0; vfn < 4096; vfn++) {
+      pte = pagetable_lookup(sim, pt, vfn << 40 | vfn, REF_KIND_LOAD);
+      assert(pte && pte->vfn == (vfn << 40 | vfn) && !pte->valid);
+    }
+    assert(pt->hash_size == 4096 && pt->hash_bits > PAGETABLE_HASH_MIN_BITS);
+    for (vfn = 0; vfn < 4096; vfn++)
+      assert(pagetable_lookup(sim, pt, vfn << 40 | vfn, REF_KIND_LOAD)->vfn ==
+	     (vfn << 40 | vfn));
+    pte = pagetable_lookup(sim, pt, top, REF_KIND_CODE);
+    assert(pte->vfn == top && pagetable_lookup(sim, pt, top, REF_KIND_CODE) == pte);
+    assert(sim->stats->compulsory[REF_KIND_LOAD] == 4096);
+    assert(vaddr_to_vfn(~(vaddr_t)0, pt->addr_bits, pt->page_bits) == top);
   }
+  sim_free(sim);
 }
 
-void pagetable_test_entry(uint vfn, int l1, int l2) {
+void pagetable_test_entry(sim_t *sim, pagetable_t *pt, uint vfn, int l1,
+			  int l2) {
+  pagetable_node_t *root_table = pt->root;
   pte_t *pte;
   printf("Looking up %u\n", vfn);
-  pte = pagetable_lookup_vaddr(vfn, REF_KIND_CODE);
+  pte = pagetable_lookup_vaddr(sim, pt, vfn, REF_KIND_CODE);
   assert(pte && pte->vfn == vfn);
   assert(root_table->table[l1]);
-  assert(((pagetable_t*)root_table->table[l1])->table[l2]);
-  assert(((pte_t*)((pagetable_t*)root_table->table[l1])->table[l2])->vfn == vfn);
+  assert(((pagetable_node_t*)root_table->table[l1])->table[l2]);
+  assert(((pte_t*)((pagetable_node_t*)root_table->table[l1])->table[l2])->vfn == vfn);
 }
 
-void pagetable_dump() {
-  assert(root_table);
-  assert(root_table->level==0);
-  uint vfn_bits=addr_space_bits-log_2(opts.pagesize);
+void pagetable_dump(sim_t *sim, pagetable_t *pt) {
+  pagetable_node_t *root_table = pt->root;
+  assert(pt->flat || pt->hash || root_table);
+  assert(pt->flat || pt->hash || root_table->level==0);
+  uint vfn_bits=pt->vfn_bits;
   /*page_bits = log_2(opts.pagesize);
   if (page_bits == -1) {
     fprintf(stderr, "vmsim: Pagesize must be a power of 2\n");
@@ -205,13 +399,16 @@ void pagetable_dump() {
   }
   vfn_bits = addr_space_bits - page_bits;
   */
-  uint pt_size=pow_2(vfn_bits);
+  /* hashed tables are dumped slot by slot */
+  uint pt_size=pt->hash ? pow_2(pt->hash_bits) : pow_2(vfn_bits);
   printf("\nCurrent page table pte fields.        valid     vfn     pfn     modified     reference     counter\n");
   uint i;
   for(i=0; i< pt_size;i++) {
-	  if(root_table->table[i]) {
-		  pte_t *pte=(pte_t *) root_table->table[i];
-		  printf("table[0x%x]:\t\t\t         %d      0x%x\t0x%x        %d             %d           %d\n",  
+	  pte_t *pte = pt->flat ? (pt->flat_seen[i] ? &pt->flat[i] : NULL)
+				: pt->hash ? pt->hash[i]
+				: (pte_t *) root_table->table[i];
+	  if(pte) {
+		  printf("table[0x%x]:\t\t\t         %d      0x%llx\t0x%x        %d             %d           %d\n",  
 			  i,
 			  pte->valid,
 			  pte->vfn,
@@ -1,23 +1,37 @@
 #ifndef PAGETABLE_H
 #define PAGETABLE_H
 
+#include <limits.h>
 #include <vmsim.h>
+#include <list.h>
+#include <arena.h>
 
 //Default values that can be overwritten from the command line
 const static int pagesize = 4096;
 const static int log_pagesize = 12;
 
+/* pte->counter of a page that has never been referenced. */
+#define PTE_NEVER_USED INT_MIN
+
 typedef struct _pte {
-  uint           vfn; /* Virtual frame number */
+  vfn_t          vfn; /* Virtual frame number */
   uint           pfn; /* Physical frame number iff valid=1 */
   int           reference;
   bool_t        valid; /* True if in physmem, false otherwise */
   bool_t        modified;
-  int 		counter;  /* used for LRU, FIFO */
-  int		frequency; /*used for LFU and MFU */
+  int 		counter;  /* time of the last reference, or PTE_NEVER_USED */
   int 		c; //keeping track of FIFO order in LFU and MFU
-  int		used; //the used bit for clock algorithm
-  int           chance; //The modification bit for second chance algorithm	
+  list_node_t   lru; /* Recency list link for LRU, MRU first */
+  list_node_t   aux; /* A second list link, for handlers that need two */
+  list_node_t   dirty; /* On the flusher's list while resident and dirty */
+  int           queue; /* Handler-private list and status bits (ARC, LIRS, CLOCK-Pro) */
+  proc_t        *proc; /* The process whose address space holds the page */
+  uint          mrc_time; /* last access in the lru-mrc analysis, 0 if none */
+  uint          next_ref; /* opt: position of the page's next reference */
+  byte_t        prefetched; /* PREFETCH_UNUSED/MARKER until referenced */
+  bool_t        untouched; /* created by a prefetch; never referenced */
+  bool_t        huge; /* part of a huge page (-H) */
+  bool_t        filled; /* loaded by a huge page promotion, not referenced */
 
 } pte_t;
 
@@ -34,7 +48,70 @@ void pte_print(pte_t *pte)
           }   
   }
 */
-void pagetable_init();
+#define PAGETABLE_MAX_LEVELS 3
+
+typedef struct _pagetable_level {
+  uint size;
+  uint log_size;
+  bool_t is_leaf;
+} pagetable_level_t;
+
+/* Structure representing one level of our multi-level pagetable */
+typedef struct _pagetable_node {
+  void **table; /* If lowest-level, array of pte_t pointers;
+		  * otherwise array of pagetable_node_t pointers. */
+  int level;
+} pagetable_node_t;
+
+/* The levels can hold vfns of at most this many bits; wider virtual page
+ * spaces are kept in a hash table instead. */
+#define PAGETABLE_RADIX_MAX_BITS 32
+
+/* A simulation's page table. The level sizes depend on the pagesize. */
+typedef struct _pagetable {
+  proc_t *proc; /* the process this is the address space of */
+  pagetable_level_t levels[PAGETABLE_MAX_LEVELS];
+  /* vfn_bits is number of bits in the virtual frame number *
+   * vfn_bits should be sum of log_size fields of all levels */
+  uint vfn_bits;
+  uint addr_bits; /* opts.addr_bits */
+  uint page_bits; /* log_2(pagesize) */
+  uint walk_levels; /* entries a walk reads: 1 for flat and hashed tables */
+  vaddr_t vaddr_mask; /* the addr_bits bits of a vaddr that are used */
+  /*root->table is the top level. For a 1-level table use pte_t *pte=(pte_t *) root->table[i] to access each pte entry*/
+  pagetable_node_t *root;
+  /* Flat tables: if the virtual page space has at most opts.flat_max
+   * pages, root is NULL and flat[vfn] is the pte_t of every vfn;
+   * flat_seen[vfn] is set once the vfn has been referenced. */
+  pte_t *flat;
+  byte_t *flat_seen;
+  /* Hashed tables: if vfn_bits exceeds PAGETABLE_RADIX_MAX_BITS, root is
+   * NULL and the pte_t of each vfn seen is in an open addressed table of
+   * 2^hash_bits slots, probed linearly from the vfn's hash. Only pages
+   * actually referenced cost memory, however sparse the space is. */
+  pte_t **hash;
+  uint hash_bits;
+  size_t hash_size; /* slots in use */
+  /* Every level, pte_t and flat array is allocated from here, and is
+   * released at once by pagetable_free. */
+  arena_t arena;
+} pagetable_t;
+
+/* Default for opts.flat_max. */
+#define PAGETABLE_FLAT_DEFAULT 65536
+
+/* Build an empty page table for sim->opts.pagesize, holding the address
+ * space of proc. */
+pagetable_t *pagetable_new(sim_t *sim, proc_t *proc);
+void pagetable_free(pagetable_t *pt);
+
+/* Bytes of page table memory handed out so far. */
+static inline size_t pagetable_bytes(pagetable_t *pt) {
+  size_t bytes = pt->arena.used;
+  if (pt->hash)
+    bytes += ((size_t)1 << pt->hash_bits) * sizeof(pte_t*);
+  return bytes;
+}
 
 /* Lookup the page table entry for the given virtual page.
  * If the page is not in memory, will have valid==0.
@@ -42,9 +119,19 @@ void pagetable_init();
  * with the given vfn and valid==0.
  * type is for statistical tracking.
  */
-pte_t *pagetable_lookup_vaddr(uint vfn, ref_kind_t type);
+pte_t *pagetable_lookup_vaddr(sim_t *sim, pagetable_t *pt, vfn_t vfn,
+			      ref_kind_t type);
+
+/* pagetable_lookup_vaddr, with the common case of a flat table entry that
+ * has been referenced before inlined into the caller. */
+static inline pte_t *pagetable_lookup(sim_t *sim, pagetable_t *pt, vfn_t vfn,
+				      ref_kind_t type) {
+  if (pt->flat && pt->flat_seen[vfn])
+    return &pt->flat[vfn];
+  return pagetable_lookup_vaddr(sim, pt, vfn, type);
+}
 
 void pagetable_test();
 
-void pagetable_dump();
+void pagetable_dump(sim_t *sim, pagetable_t *pt);
 #endif /* PAGETABLE_H */
@@ -1,25 +1,45 @@
 //#include <config.h>
 #include <assert.h>
+#include <limits.h>
+#include <stdio.h>
 #include <stdlib.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
+#include <util.h>
 #include <options.h>
 #include <pagetable.h>
 #include <physmem.h>
 #include <stats.h>
+#include <proc.h>
+#include <sim.h>
 
-pte_t **physmem;
+void physmem_init(sim_t *sim) {
+  sim->physmem = (pte_t**)(calloc(sim->opts.phys_pages, sizeof(pte_t*)));
+  assert(sim->physmem);
+  sim->frametab.last_use = (int*)calloc(sim->opts.phys_pages, sizeof(int));
+  sim->frametab.load_order = (int*)calloc(sim->opts.phys_pages, sizeof(int));
+  sim->frametab.dirty = (byte_t*)calloc(sim->opts.phys_pages, sizeof(byte_t));
+  assert(sim->frametab.last_use && sim->frametab.load_order &&
+	 sim->frametab.dirty);
+}
 
-void physmem_init() {
-  physmem = (pte_t**)(calloc(opts.phys_pages, sizeof(pte_t*)));
-  assert(physmem);
+void physmem_free(sim_t *sim) {
+  free(sim->physmem);
+  free(sim->frametab.last_use);
+  free(sim->frametab.load_order);
+  free(sim->frametab.dirty);
+  sim->physmem = NULL;
 }
 
-pte_t **physmem_array() {
-  return physmem;
+pte_t **physmem_array(sim_t *sim) {
+  return sim->physmem;
 }
 
-void physmem_evict(uint pfn, ref_kind_t type) {
-  assert(0 <= pfn && pfn < opts.phys_pages);
+void physmem_evict(sim_t *sim, uint pfn, ref_kind_t type) {
+  pte_t **physmem = sim->physmem;
+  assert(0 <= pfn && pfn < sim->opts.phys_pages);
 
   /* No page here - nothing to do */
   if(physmem[pfn] == NULL || !physmem[pfn]->valid) {
@@ -31,18 +51,34 @@ void physmem_evict(uint pfn, ref_kind_t type) {
   printf("Evicting page frame with pfn=0x%x to disk\n", pfn);
   //printf("Evicting page frame with pfn=0x%x, type=%c to disk\n", pfn, type==REF_KIND_LOAD? 'R':'W');
 #endif
-  stats_evict(type);
+  stats_evict(sim->stats, type);
+  stats_evict(&physmem[pfn]->proc->stats, type);
   if (physmem[pfn]->modified) {
-    stats_evict_dirty(type);
+    stats_evict_dirty(sim->stats, type);
+    stats_evict_dirty(&physmem[pfn]->proc->stats, type);
+    /* The victim must be written before its frame is reused. */
+    if (sim->opts.cost)
+      sim->stats->stall_out += sim->opts.page_out_ns;
+    if (sim->writeback)
+      writeback_evict(sim->writeback, physmem[pfn]);
+  }
+  if (sim->tlb)
+    tlb_invalidate(sim->tlb, physmem[pfn]);
+  if (sim->huge)
+    huge_evict(sim, physmem[pfn]);
+  if (physmem[pfn]->prefetched) {
+    sim->stats->prefetch_wasted++;
+    physmem[pfn]->prefetched = 0;
   }
-  physmem[pfn]->frequency=0;
   physmem[pfn]->modified = 0;
   physmem[pfn]->valid = 0;
   physmem[pfn] = NULL;
+  sim->stats->resident--;
 }
 
-void physmem_load(uint pfn, pte_t *new_page, ref_kind_t type) {
-  assert(0 <= pfn && pfn < opts.phys_pages);
+void physmem_load(sim_t *sim, uint pfn, pte_t *new_page, ref_kind_t type) {
+  pte_t **physmem = sim->physmem;
+  assert(0 <= pfn && pfn < sim->opts.phys_pages);
   assert(new_page && !new_page->valid);
   assert(physmem[pfn] == NULL);
 
@@ -52,17 +88,25 @@ void physmem_load(uint pfn, pte_t *new_page, ref_kind_t type) {
   physmem[pfn]->reference = 0;
   physmem[pfn]->modified = 0;
   physmem[pfn]->valid = 1;
+  physmem[pfn]->c = sim->fault_counter++;
+  sim->frametab.last_use[pfn] = new_page->counter;
+  sim->frametab.load_order[pfn] = new_page->c;
+  sim->frametab.dirty[pfn] = 0;
+  sim->stats->resident++;
+  if (sim->huge)
+    huge_load(sim, new_page);
 }
 
-void physmem_dump() {
+void physmem_dump(sim_t *sim) {
+  pte_t **physmem = sim->physmem;
   uint i;
  // printf("physmem fields pfn:valid:reference:modified\n");
-  printf("\nCurrent physmem pte fields.\tvalid  \tvfn  \tpfn         modified        reference        counter       ResetCounter          frequency\n");
+  printf("\nCurrent physmem pte fields.\tvalid  \tvfn  \tpfn         modified        reference        counter       ResetCounter\n");
 
-  for(i = 0 ; i < opts.phys_pages; i++) {
+  for(i = 0 ; i < sim->opts.phys_pages; i++) {
                  pte_t *pte=(pte_t *) physmem[i];
 		 if (pte) {
-                 printf("physmem[0x%x]: \t\t\t%d  \t0x%x  \t0x%x  \t\t%d  \t\t%d \t\t%d \t\t %d \t\t      %d\n",
+                 printf("physmem[0x%x]: \t\t\t%d  \t0x%llx  \t0x%x  \t\t%d  \t\t%d \t\t%d \t\t %d\n",
                           i,
                           pte->valid,
                           pte->vfn,
@@ -70,8 +114,122 @@ void physmem_dump() {
                           pte->modified,
                           pte->reference,
 			  pte->counter,
-                          pte->c,
-			  pte->frequency);
+                          pte->c);
 		}
   }
 }
+
+/* The kernels below take 4 ints or 16 bytes a step with SSE2, which
+ * every x86-64 target has, and finish (or, elsewhere, do everything)
+ * one frame at a time. */
+
+uint physmem_argmin(const int *a, uint from, uint to) {
+  uint i = from + 1, best = from;
+#ifdef __SSE2__
+  int min[4], at[4], l;
+  __m128i m, idx, where, v, lt, step;
+#endif
+
+  if (from >= to)
+    return to;
+#ifdef __SSE2__
+  if (to - from >= 8) {
+    /* Each lane keeps its own first minimum and where it was. */
+    m = _mm_loadu_si128((const __m128i*)(a + from));
+    idx = where = _mm_setr_epi32(from, from + 1, from + 2, from + 3);
+    step = _mm_set1_epi32(4);
+    for (i = from + 4; i + 4 <= to; i += 4) {
+      idx = _mm_add_epi32(idx, step);
+      v = _mm_loadu_si128((const __m128i*)(a + i));
+      lt = _mm_cmplt_epi32(v, m);
+      m = _mm_or_si128(_mm_and_si128(lt, v), _mm_andnot_si128(lt, m));
+      where = _mm_or_si128(_mm_and_si128(lt, idx), _mm_andnot_si128(lt, where));
+    }
+    _mm_storeu_si128((__m128i*)min, m);
+    _mm_storeu_si128((__m128i*)at, where);
+    best = at[0];
+    for (l = 1; l < 4; l++)
+      if (min[l] < a[best] || (min[l] == a[best] && (uint)at[l] < best))
+	best = at[l];
+  }
+#endif
+  for (; i < to; i++)
+    if (a[i] < a[best])
+      best = i;
+  return best;
+}
+
+uint physmem_first_le(const int *a, uint from, uint to, int limit) {
+  uint i = from;
+#ifdef __SSE2__
+  __m128i l = _mm_set1_epi32(limit);
+  int over;
+
+  for (; i + 4 <= to; i += 4) {
+    over = _mm_movemask_ps(_mm_castsi128_ps(
+	_mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)(a + i)), l)));
+    if (over != 0xf)
+      return i + first_set(~over & 0xf);
+  }
+#endif
+  for (; i < to; i++)
+    if (a[i] <= limit)
+      return i;
+  return to;
+}
+
+uint physmem_first_clear(const byte_t *ref, const byte_t *dirty, uint from,
+			 uint to, byte_t want) {
+  uint i = from;
+#ifdef __SSE2__
+  __m128i zero = _mm_setzero_si128(), w = _mm_set1_epi8(want);
+  int match;
+
+  for (; i + 16 <= to; i += 16) {
+    match = _mm_movemask_epi8(_mm_and_si128(
+	_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(ref + i)), zero),
+	_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(dirty + i)), w)));
+    if (match)
+      return i + first_set(match);
+  }
+#endif
+  for (; i < to; i++)
+    if (!ref[i] && dirty[i] == want)
+      return i;
+  return to;
+}
+
+/* Check the kernels against plain loops over every range of a small
+ * array, which covers the vector bodies, their tails and ties. */
+void physmem_test() {
+  int a[40];
+  byte_t ref[40], dirty[40];
+  uint from, to, i, want;
+
+  printf("Testing physmem scans\n");
+  for (i = 0; i < 40; i++) {
+    a[i] = (int)((i * 7919) % 13) - 6;
+    ref[i] = (i % 3) == 0;
+    dirty[i] = (i % 5) < 2;
+  }
+  a[17] = INT_MIN;
+  a[31] = INT_MIN;
+  for (from = 0; from <= 40; from++) {
+    for (to = from; to <= 40; to++) {
+      want = to;
+      for (i = from; i < to; i++)
+	if (want == to || a[i] < a[want])
+	  want = i;
+      assert(physmem_argmin(a, from, to) == want);
+      for (want = from; want < to && a[want] > -3; want++)
+	;
+      assert(physmem_first_le(a, from, to, -3) == want);
+      for (want = from; want < to && (ref[want] || !dirty[want]); want++)
+	;
+      assert(physmem_first_clear(ref, dirty, from, to, 1) == want);
+      for (want = from; want < to && (ref[want] || dirty[want]); want++)
+	;
+      assert(physmem_first_clear(ref, dirty, from, to, 0) == want);
+    }
+  }
+}
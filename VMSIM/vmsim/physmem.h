@@ -9,28 +9,54 @@
 #include <vmsim.h>
 #include <pagetable.h>
 
+/* The replacement state handlers scan, one array per field indexed by
+ * pfn, so a scan reads only the field it compares and can compare many
+ * frames at once. Copies of pte fields, kept current by physmem_load and
+ * sim_reference (and the flusher for dirty); slots of empty frames are
+ * stale. A partition's arrays point into its sim's. */
+typedef struct _frametab {
+  int *last_use;    /* pte->counter */
+  int *load_order;  /* pte->c */
+  byte_t *dirty;    /* pte->modified */
+} frametab_t;
+
 /* Initialize physical memory to all-empty. */
-void physmem_init();
+void physmem_init(sim_t *sim);
+void physmem_free(sim_t *sim);
 
-/* Get an array of pte_ts representing physical memory.
+/* Get an array of pte_ts representing physical memory (sim->physmem).
  * Do not modify this array directly; do not modify elements of it directly.
  * Use physmem_evict/physmem_load.
- * There are opts.phys_pages elements in the array.
+ * There are sim->opts.phys_pages elements in the array.
  * Empty elements are NULL. */
-pte_t** physmem_array();
+pte_t** physmem_array(sim_t *sim);
 
 /* Evict the page at the given pfn from memory. type should specify
  * the type of reference casuing the eviction (i.e., the type passed
  * to the fault handler). Will mark the pfn as empty (suitable for
  * physmem_load). */
-void physmem_evict(uint pfn, ref_kind_t type);
+void physmem_evict(sim_t *sim, uint pfn, ref_kind_t type);
 
 /* Load the given page (pte) into the given physical memory slot (pfn).
  * That slot should be empty (either because it has never been used, or
  * because the page there has been evicted). type should specify what
  * kind of reference casused the load. */
-void physmem_load(uint pfn, pte_t *pte, ref_kind_t type);
-void physmem_dump();
-extern pte_t **physmem;
+void physmem_load(sim_t *sim, uint pfn, pte_t *pte, ref_kind_t type);
+void physmem_dump(sim_t *sim);
+
+/* Scans of frametab_t arrays over [from, to); each returns to if no
+ * frame qualifies. Vectorized where the target allows. */
+
+/* The first index of the smallest a[i]. */
+uint physmem_argmin(const int *a, uint from, uint to);
+
+/* The first i with a[i] <= limit. */
+uint physmem_first_le(const int *a, uint from, uint to, int limit);
+
+/* The first i with ref[i] == 0 and dirty[i] == want. */
+uint physmem_first_clear(const byte_t *ref, const byte_t *dirty, uint from,
+			 uint to, byte_t want);
+
+void physmem_test();
 
 #endif /* PHYSMEM_H */
@@ -0,0 +1,173 @@
+/*
+ * prefetch.c - Prefetch policies. See prefetch.h.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vmsim.h>
+#include <options.h>
+#include <pagetable.h>
+#include <stats.h>
+#include <fault.h>
+#include <proc.h>
+#include <sim.h>
+#include <trace.h>
+#include <prefetch.h>
+
+/* Most pages to prefetch at once: N, or half of the frames. */
+static inline uint prefetch_limit(sim_t *sim, proc_t *proc) {
+  sim_t *frames = proc->frames ? proc->frames : sim;
+  uint half = frames->opts.phys_pages / 2;
+  return sim->opts.prefetch_pages < half ? sim->opts.prefetch_pages : half;
+}
+
+/* Bring in page vfn of proc unless it is resident or outside the address
+ * space. */
+static void prefetch_page(sim_t *sim, proc_t *proc, vfn_t vfn, ref_kind_t type,
+			  int mark) {
+  pagetable_t *pt = proc->pagetable;
+  sim_t *frames = proc->frames ? proc->frames : sim;
+  count_t evictions;
+  pte_t *pte;
+
+  if (pt->vfn_bits < 64 && vfn >> pt->vfn_bits)
+    return;
+  pte = pagetable_lookup(sim, pt, vfn, REF_KIND_PREFETCH);
+  if (pte->valid)
+    return;
+
+  evictions = stats_total(sim->stats->evictions);
+  frames->ref_counter = sim->ref_counter;
+  sim->opts.fault_handler->handler(frames, pte, type);
+  pte->prefetched = mark;
+  sim->stats->prefetched++;
+  sim->stats->prefetch_evictions += stats_total(sim->stats->evictions) -
+    evictions;
+}
+
+/* Read the next window of pages from start, marking its middle page. */
+static void prefetch_window(sim_t *sim, proc_t *proc, vfn_t start,
+			    ref_kind_t type) {
+  prefetch_state_t *ps = &proc->prefetch;
+  uint i;
+
+  for (i = 0; i < ps->window; i++)
+    prefetch_page(sim, proc, start + i, type,
+		  i == ps->window / 2 ? PREFETCH_MARKER : PREFETCH_UNUSED);
+  ps->next = start + ps->window;
+}
+
+/* Double the adaptive window, from PREFETCH_INITIAL up to the limit. */
+static inline void prefetch_ramp(sim_t *sim, proc_t *proc) {
+  prefetch_state_t *ps = &proc->prefetch;
+  uint limit = prefetch_limit(sim, proc);
+
+  ps->window = ps->window ? 2 * ps->window : PREFETCH_INITIAL;
+  if (ps->window > limit)
+    ps->window = limit;
+}
+
+/* Note an access at vfn and, if it repeats the last stride, read ahead
+ * along it. */
+static void prefetch_stride(sim_t *sim, proc_t *proc, vfn_t vfn,
+			    ref_kind_t type) {
+  prefetch_state_t *ps = &proc->prefetch;
+  long long stride = ps->seen ? (long long)(vfn - ps->last_miss) : 0;
+  uint i, n = prefetch_limit(sim, proc);
+
+  if (stride != 0 && stride == ps->stride) {
+    for (i = 1; i <= n; i++) {
+      if (stride < 0 && (vfn_t)(-stride) * i > vfn)
+	break;
+      prefetch_page(sim, proc, vfn + stride * i, type, PREFETCH_UNUSED);
+    }
+  }
+  ps->stride = stride;
+  ps->last_miss = vfn;
+  ps->seen = TRUE;
+}
+
+void prefetch_miss(sim_t *sim, proc_t *proc, pte_t *pte, ref_kind_t type) {
+  prefetch_state_t *ps = &proc->prefetch;
+  vfn_t vfn = pte->vfn;
+  uint i, n;
+
+  switch (sim->opts.prefetch) {
+  case PREFETCH_NEXT:
+    n = prefetch_limit(sim, proc);
+    for (i = 1; i <= n; i++)
+      prefetch_page(sim, proc, vfn + i, type, PREFETCH_UNUSED);
+    break;
+  case PREFETCH_STRIDE:
+    prefetch_stride(sim, proc, vfn, type);
+    return;
+  case PREFETCH_ADAPTIVE:
+    /* Sequential, or readahead fell behind and faulted past the window. */
+    if (ps->seen && (vfn == ps->last_miss + 1 ||
+		     (ps->window && vfn == ps->next))) {
+      prefetch_ramp(sim, proc);
+      prefetch_window(sim, proc, vfn + 1, type);
+    } else {
+      ps->window = 0;
+    }
+    break;
+  default:
+    assert(0);
+  }
+  ps->last_miss = vfn;
+  ps->seen = TRUE;
+}
+
+void prefetch_hit(sim_t *sim, proc_t *proc, pte_t *pte, ref_kind_t type,
+		  int mark) {
+  prefetch_state_t *ps = &proc->prefetch;
+
+  sim->stats->prefetch_useful++;
+  if (sim->opts.prefetch == PREFETCH_STRIDE) {
+    prefetch_stride(sim, proc, pte->vfn, type);
+  } else if (sim->opts.prefetch == PREFETCH_ADAPTIVE &&
+	     mark == PREFETCH_MARKER && ps->window) {
+    prefetch_ramp(sim, proc);
+    prefetch_window(sim, proc, ps->next, type);
+  }
+}
+
+/* Faults of one pass over 64 pages, stride pages apart, in 16 frames. */
+static count_t prefetch_test_scan(prefetch_policy_t policy, uint pages,
+				  uint stride) {
+  trace_ref_t ref = { 1, REF_KIND_LOAD, 0 };
+  opts_t config;
+  count_t faults;
+  sim_t *sim;
+  uint i;
+
+  sim_test_config(&config, "fifo", 16);
+  config.prefetch = policy;
+  config.prefetch_pages = pages;
+  sim = sim_new(&config);
+  for (i = 0; i < 64; i++) {
+    ref.vaddr = i * stride * 16;
+    sim_reference(sim, &ref);
+  }
+  faults = stats_total(sim->stats->miss);
+  assert(stats_total(sim->stats->compulsory) == faults);
+  assert(sim->stats->prefetch_useful + sim->stats->prefetch_wasted <=
+	 sim->stats->prefetched);
+  sim_free(sim);
+  return faults;
+}
+
+void prefetch_test() {
+  printf("Testing prefetching\n");
+  assert(prefetch_test_scan(PREFETCH_NONE, 0, 1) == 64);
+  assert(prefetch_test_scan(PREFETCH_NEXT, 3, 1) == 16);
+  /* Next-N reads two pages the scan skips for each one it uses */
+  assert(prefetch_test_scan(PREFETCH_NEXT, 3, 3) == 32);
+  /* Three faults to see the stride twice; the first uses of prefetched
+   * pages keep it going */
+  assert(prefetch_test_scan(PREFETCH_STRIDE, 3, 3) == 3);
+  /* The second fault starts readahead, which stays ahead of the scan */
+  assert(prefetch_test_scan(PREFETCH_ADAPTIVE, 8, 1) == 2);
+}
@@ -0,0 +1,52 @@
+/*
+ * prefetch.h - Prefetching on page faults (-P POLICY).
+ *
+ *   next:N          read the N pages after each faulting page.
+ *   stride:N        per pid, once two successive faults (or first uses
+ *                   of prefetched pages) are the same distance apart,
+ *                   read the next N pages at that stride.
+ *   adaptive[:MAX]  per pid readahead in the manner of Linux: a fault on
+ *                   the page after the previous fault starts a window of
+ *                   PREFETCH_INITIAL pages. Referencing the marked page in
+ *                   the middle of a window reads the next window, twice
+ *                   as large up to MAX, before it is needed. A fault
+ *                   anywhere else stops readahead.
+ *
+ * Prefetched pages are brought in through the fault handler, so the
+ * replacement algorithm picks their victims. A prefetch is useful if the
+ * page is referenced before it is evicted and wasted otherwise. No more
+ * than half of a process's frames are prefetched at once.
+ */
+
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <vmsim.h>
+#include <pagetable.h>
+
+#define PREFETCH_INITIAL 4
+#define PREFETCH_ADAPTIVE_MAX 32
+
+/* pte->prefetched: loaded by the prefetcher and not referenced since. */
+#define PREFETCH_UNUSED 1
+#define PREFETCH_MARKER 2  /* also the trigger for the next window */
+
+/* Per-process prefetch state, in proc_t. */
+typedef struct _prefetch_state {
+  bool_t seen;        /* last_miss is valid */
+  vfn_t last_miss;
+  long long stride;   /* stride: distance between the last two misses */
+  uint window;        /* adaptive: pages in the current window, 0 if none */
+  vfn_t next;         /* adaptive: the first page after the window */
+} prefetch_state_t;
+
+/* Called by sim_reference() once a reference to pte has been handled:
+ * prefetch_miss after a fault, prefetch_hit on the first reference to a
+ * prefetched page, with the pte->prefetched value it had. */
+void prefetch_miss(sim_t *sim, proc_t *proc, pte_t *pte, ref_kind_t type);
+void prefetch_hit(sim_t *sim, proc_t *proc, pte_t *pte, ref_kind_t type,
+		  int mark);
+
+void prefetch_test();
+
+#endif /* PREFETCH_H */
@@ -0,0 +1,170 @@
+/*
+ * proc.c - Find (or create) the process of each reference.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <vmsim.h>
+#include <options.h>
+#include <pagetable.h>
+#include <stats.h>
+#include <fault.h>
+#include <proc.h>
+#include <sim.h>
+
+/* Initial size of the pid table, as a power of 2. */
+#define PROC_MIN_BITS 4
+
+static proc_t *proc_new(sim_t *sim, uint pid);
+static void proc_grow(proctab_t *procs);
+
+void proc_init(sim_t *sim) {
+  proctab_t *procs = &sim->procs;
+
+  procs->bits = PROC_MIN_BITS;
+  procs->size = 0;
+  procs->slots = (proc_t**)calloc(pow_2(procs->bits), sizeof(proc_t*));
+  assert(procs->slots);
+  procs->last = NULL;
+  procs->list = NULL;
+  procs->tail = &procs->list;
+  procs->next_frame = 0;
+}
+
+void proc_free(sim_t *sim) {
+  proctab_t *procs = &sim->procs;
+  proc_t *proc, *next;
+
+  for (proc = procs->list; proc; proc = next) {
+    next = proc->next;
+    if (proc->frames)
+      sim_partition_free(proc->frames);
+    pagetable_free(proc->pagetable);
+    free(proc);
+  }
+  free(procs->slots);
+  procs->slots = NULL;
+  procs->list = procs->last = NULL;
+}
+
+/* Fibonacci hashing, as for hashed page tables. */
+static inline uint proc_hash(uint pid, uint bits) {
+  return (uint)((pid * 0x9e3779b9U) >> (32 - bits));
+}
+
+proc_t *proc_lookup_slow(sim_t *sim, proctab_t *procs, uint pid) {
+  uint mask = pow_2(procs->bits) - 1;
+  uint i = proc_hash(pid, procs->bits);
+  proc_t *proc;
+
+  while ((proc = procs->slots[i]) != NULL) {
+    if (proc->pid == pid)
+      return procs->last = proc;
+    i = (i + 1) & mask;
+  }
+
+  proc = procs->slots[i] = proc_new(sim, pid);
+  *procs->tail = proc;
+  procs->tail = &proc->next;
+  if (++procs->size > mask / 2)
+    proc_grow(procs);
+  return procs->last = proc;
+}
+
+/* Double the pid table and reinsert every process. */
+void proc_grow(proctab_t *procs) {
+  proc_t *proc;
+  uint i, mask;
+
+  free(procs->slots);
+  procs->bits++;
+  mask = pow_2(procs->bits) - 1;
+  procs->slots = (proc_t**)calloc(mask + 1, sizeof(proc_t*));
+  assert(procs->slots);
+  for (proc = procs->list; proc; proc = proc->next) {
+    i = proc_hash(proc->pid, procs->bits);
+    while (procs->slots[i] != NULL)
+      i = (i + 1) & mask;
+    procs->slots[i] = proc;
+  }
+}
+
+proc_t *proc_new(sim_t *sim, uint pid) {
+  proctab_t *procs = &sim->procs;
+  proc_t *proc;
+  uint frames;
+
+  proc = (proc_t*)calloc(1, sizeof(proc_t));
+  assert(proc);
+  proc->pid = pid;
+  proc->pagetable = pagetable_new(sim, proc);
+
+  if (sim->opts.local_frames) {
+    /* The last process to arrive may have to make do with less. */
+    frames = sim->opts.phys_pages - procs->next_frame;
+    if (frames > sim->opts.local_frames)
+      frames = sim->opts.local_frames;
+    if (frames < MIN_PHYS_PAGES) {
+      fprintf(stderr, "vmsim: no frames left for pid %u; %d processes fit in %d pages with local replacement\n",
+	      pid, procs->size, sim->opts.phys_pages);
+      exit(1);
+    }
+    proc->frames = sim_partition(sim, procs->next_frame, frames);
+    procs->next_frame += frames;
+  }
+  return proc;
+}
+
+size_t proc_pagetable_bytes(sim_t *sim, size_t *reserved) {
+  proc_t *proc;
+  size_t bytes = 0;
+
+  *reserved = 0;
+  for (proc = sim->procs.list; proc; proc = proc->next) {
+    bytes += pagetable_bytes(proc->pagetable);
+    *reserved += proc->pagetable->arena.reserved;
+  }
+  return bytes;
+}
+
+void proc_test() {
+  opts_t config = opts;
+  sim_t *sim;
+  proc_t *a, *b;
+  pte_t *pa, *pb;
+  uint pid;
+
+  printf("Testing processes\n");
+  config.test = FALSE; /* quiet page table setup */
+  config.phys_pages = 12;
+  config.local_frames = 0;
+  sim = sim_new(&config);
+  a = proc_lookup(sim, &sim->procs, 1);
+  b = proc_lookup(sim, &sim->procs, 2);
+  assert(a && b && a != b && a->pid == 1 && b->pid == 2);
+  assert(proc_lookup(sim, &sim->procs, 1) == a);
+  assert(!a->frames && !b->frames);
+  /* the same page of two processes is two pages */
+  pa = pagetable_lookup(sim, a->pagetable, 3, REF_KIND_LOAD);
+  pb = pagetable_lookup(sim, b->pagetable, 3, REF_KIND_LOAD);
+  assert(pa != pb && pa->proc == a && pb->proc == b);
+  assert(a->stats.compulsory[REF_KIND_LOAD] == 1);
+  assert(sim->stats->compulsory[REF_KIND_LOAD] == 2);
+  /* enough pids to grow the table, sparse ones included */
+  for (pid = 0; pid < 100; pid++)
+    assert(proc_lookup(sim, &sim->procs, pid * 65537)->pid == pid * 65537);
+  assert(sim->procs.size == 102 && proc_lookup(sim, &sim->procs, 2) == b);
+  sim_free(sim);
+
+  printf("Testing local replacement\n");
+  config.local_frames = 5;
+  sim = sim_new(&config);
+  a = proc_lookup(sim, &sim->procs, 1);
+  b = proc_lookup(sim, &sim->procs, 2);
+  assert(a->frames && b->frames);
+  assert(a->frames->opts.phys_pages == 5 && b->frames->opts.phys_pages == 5);
+  assert(b->frames->physmem == a->frames->physmem + 5);
+  sim_free(sim);
+}
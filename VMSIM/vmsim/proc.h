@@ -0,0 +1,62 @@
+/*
+ * proc.h - The processes of a simulation, one per trace pid. Each has its
+ *          own address space (page table) and fault statistics, created
+ *          the first time the pid is referenced. All of them share the
+ *          simulation's physical memory.
+ *
+ *          Under global replacement (the default) a fault may evict any
+ *          process's page. Under local replacement (-r local:FRAMES) each
+ *          process is allotted FRAMES frames of physmem when it first
+ *          appears and only ever replaces pages among them.
+ */
+
+#ifndef PROC_H
+#define PROC_H
+
+#include <vmsim.h>
+#include <pagetable.h>
+#include <stats.h>
+#include <prefetch.h>
+
+struct _proc {
+  uint pid;
+  pagetable_t *pagetable;
+  stats_t stats;      /* this process's share of the simulation's stats */
+  /* Local replacement: a view of the frames allotted to this process,
+   * with fault handler state of its own; see sim_partition. NULL under
+   * global replacement. */
+  sim_t *frames;
+  prefetch_state_t prefetch; /* -P state, for policies that track a pid */
+  proc_t *next;       /* in order of first reference */
+};
+
+typedef struct _proctab {
+  proc_t **slots;     /* open addressed by a hash of the pid */
+  uint bits;          /* there are 2^bits slots */
+  uint size;          /* number of processes */
+  proc_t *last;       /* process of the previous reference */
+  proc_t *list;       /* every process, in order of first reference */
+  proc_t **tail;
+  uint next_frame;    /* local replacement: first frame not yet allotted */
+} proctab_t;
+
+void proc_init(sim_t *sim);
+void proc_free(sim_t *sim);
+
+proc_t *proc_lookup_slow(sim_t *sim, proctab_t *procs, uint pid);
+
+/* The process with the given pid, created if this is its first
+ * reference. procs is &sim->procs. Consecutive references almost always
+ * come from the same process, so that case is checked first. */
+static inline proc_t *proc_lookup(sim_t *sim, proctab_t *procs, uint pid) {
+  if (procs->last && procs->last->pid == pid)
+    return procs->last;
+  return proc_lookup_slow(sim, procs, pid);
+}
+
+/* Page table memory of every process. */
+size_t proc_pagetable_bytes(sim_t *sim, size_t *reserved);
+
+void proc_test();
+
+#endif /* PROC_H */
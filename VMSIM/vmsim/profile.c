@@ -0,0 +1,76 @@
+/*
+ * profile.c - The simulator's own speed. See profile.h.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include <vmsim.h>
+#include <profile.h>
+
+profile_t *profile_new() {
+  profile_t *p = (profile_t*)calloc(1, sizeof(profile_t));
+  assert(p);
+  return p;
+}
+
+void profile_free(profile_t *p) {
+  free(p);
+}
+
+void profile_start(profile_t *p) {
+  uint64_t t, d;
+  int i;
+
+  p->overhead = ~(uint64_t)0;
+  for (i = 0; i < 64; i++) {
+    t = profile_ticks();
+    d = profile_ticks() - t;
+    if (d < p->overhead)
+      p->overhead = d;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &p->start);
+  p->start_ticks = profile_ticks();
+}
+
+void profile_stop(profile_t *p, ulong refs) {
+  clock_gettime(CLOCK_MONOTONIC, &p->end);
+  p->end_ticks = profile_ticks();
+  p->sampling = FALSE;
+  p->refs = refs;
+  p->sampled = refs / PROFILE_SAMPLE;
+}
+
+void profile_output(profile_t *p, size_t pagetable_bytes, FILE *o) {
+  static const char *names[] = { "parse", "page table lookup",
+				 "fault handler" };
+  double secs = (p->end.tv_sec - p->start.tv_sec) +
+    (p->end.tv_nsec - p->start.tv_nsec) / 1e9;
+  double ns_per_tick, ns, timed = 0, ticks;
+  struct rusage usage;
+  int i;
+
+  ns_per_tick = p->end_ticks > p->start_ticks ?
+    secs * 1e9 / (p->end_ticks - p->start_ticks) : 0;
+  fprintf(o, "\n Simulator Performance:\n");
+  fprintf(o, "\tReplay: %lu references in %.3f s, %.0f references/s\n",
+	  p->refs, secs, secs > 0 ? p->refs / secs : 0.0);
+  if (p->sampled) {
+    fprintf(o, "\tns per reference (1 in %d timed):", PROFILE_SAMPLE);
+    for (i = 0; i < PROFILE_PHASES; i++) {
+      ticks = (double)p->ticks[i] - (double)p->overhead * p->timings[i];
+      ns = ticks > 0 ? ticks * ns_per_tick / p->sampled : 0;
+      timed += ns;
+      fprintf(o, " %s %.1f,", names[i], ns);
+    }
+    /* Statistics, TLB, write-back, prefetch, huge pages and the loop */
+    ns = p->refs ? secs * 1e9 / p->refs : 0;
+    fprintf(o, " other %.1f; total %.1f\n", ns > timed ? ns - timed : 0.0,
+	    ns);
+  }
+  getrusage(RUSAGE_SELF, &usage);
+  fprintf(o, "\tPeak RSS: %ld KiB, Page Table Memory: %lu bytes\n",
+	  usage.ru_maxrss, (unsigned long)pagetable_bytes);
+}
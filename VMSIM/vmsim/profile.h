@@ -0,0 +1,87 @@
+/*
+ * profile.h - The simulator's own speed (built with -DPROFILE).
+ *
+ *             A single run reports how fast the trace was replayed and
+ *             where the time went: parsing the trace, translating the
+ *             address (TLB and page table lookups) and running the fault
+ *             handler (on faults, and its hit function on hits). Reading
+ *             the clock on every reference would cost as much as some of
+ *             those phases, so only one reference in PROFILE_SAMPLE is
+ *             timed, with the cycle counter where there is one, less what
+ *             reading it costs; cycles become ns by the ratio of the two
+ *             clocks over the whole replay. Peak RSS comes from
+ *             getrusage().
+ *
+ *             Without -DPROFILE the hooks below compile to nothing.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <vmsim.h>
+
+/* References per timed reference; a power of 2. */
+#define PROFILE_SAMPLE 256
+
+typedef enum _profile_phase {
+  PROFILE_PARSE, PROFILE_LOOKUP, PROFILE_FAULT, PROFILE_PHASES
+} profile_phase_t;
+
+typedef struct _profile {
+  bool_t sampling;      /* the current reference is being timed */
+  uint64_t ticks[PROFILE_PHASES]; /* over the timed references */
+  ulong timings[PROFILE_PHASES];  /* times each phase was timed */
+  uint64_t overhead;    /* ticks read by back-to-back clock reads */
+  ulong sampled;        /* timed references */
+  ulong refs;           /* all references replayed */
+  struct timespec start, end;
+  uint64_t start_ticks, end_ticks;
+} profile_t;
+
+/* The cycle counter, or else the monotonic clock in ns. */
+static inline uint64_t profile_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+#ifdef PROFILE
+/* Declare the start time of a timed phase. */
+#define PROFILE_VAR(t) uint64_t t = 0
+/* Start or end phase in t, if p is timing this reference. */
+#define PROFILE_BEGIN(p, t) do { if ((p) && (p)->sampling) \
+      (t) = profile_ticks(); } while (0)
+#define PROFILE_END(p, phase, t) do { if ((p) && (p)->sampling) { \
+      (p)->ticks[phase] += profile_ticks() - (t); \
+      (p)->timings[phase]++; } } while (0)
+/* Before reading reference n (from 1): decide whether to time it. */
+#define PROFILE_NEXT(p, n) do { if (p) \
+      (p)->sampling = ((n) & (PROFILE_SAMPLE - 1)) == 0; } while (0)
+#else
+#define PROFILE_VAR(t)
+#define PROFILE_BEGIN(p, t)
+#define PROFILE_END(p, phase, t)
+#define PROFILE_NEXT(p, n)
+#endif
+
+profile_t *profile_new();
+void profile_free(profile_t *p);
+
+/* Bracket the replay of refs references. */
+void profile_start(profile_t *p);
+void profile_stop(profile_t *p, ulong refs);
+
+void profile_output(profile_t *p, size_t pagetable_bytes, FILE *o);
+
+#endif /* PROFILE_H */
@@ -0,0 +1,32 @@
+/*
+ * rng.c - The random number generator. See rng.h.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <rng.h>
+
+void rng_seed(rng_t *rng, uint64_t seed, uint64_t stream) {
+  rng->state = 0;
+  rng->inc = (stream << 1) | 1;
+  rng_next(rng);
+  rng->state += seed;
+  rng_next(rng);
+}
+
+void rng_test() {
+  /* The first outputs of the reference pcg32-demo, seed 42 stream 54 */
+  static const uint32_t expect[] = { 0xa15c02b7, 0x7b47f409, 0xba1d3330 };
+  rng_t rng;
+  uint i, below[4] = { 0, 0, 0, 0 };
+
+  printf("Testing rng\n");
+  rng_seed(&rng, 42, 54);
+  for (i = 0; i < 3; i++)
+    assert(rng_next(&rng) == expect[i]);
+  for (i = 0; i < 4000; i++)
+    below[rng_below(&rng, 4)]++;
+  for (i = 0; i < 4; i++)
+    assert(below[i] > 900 && below[i] < 1100);
+}
@@ -0,0 +1,47 @@
+/*
+ * rng.h - A small, fast random number generator (PCG32, O'Neill 2014).
+ *
+ *         Each user keeps its own rng_t, so simulations running at once
+ *         never share or lock generator state, and a seed always gives
+ *         the same sequence. Every generator of a simulation is seeded
+ *         from opts.seed (-S).
+ */
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+#include <vmsim.h>
+
+typedef struct _rng {
+  uint64_t state;
+  uint64_t inc;   /* the stream; always odd */
+} rng_t;
+
+/* Streams of the simulator's generators, so that those seeded alike
+ * still draw independent sequences. */
+#define RNG_STREAM_RANDOM 1   /* the random handler */
+#define RNG_STREAM_SAMPLED 2  /* sampled-lru */
+#define RNG_STREAM_TLB 3      /* TLB_RANDOM victims; + the level */
+
+/* Start rng on sequence stream from seed. */
+void rng_seed(rng_t *rng, uint64_t seed, uint64_t stream);
+
+static inline uint32_t rng_next(rng_t *rng) {
+  uint64_t old = rng->state;
+  uint32_t xorshifted = ((old >> 18) ^ old) >> 27;
+  uint32_t rot = old >> 59;
+
+  rng->state = old * 6364136223846793005ULL + rng->inc;
+  return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+/* Uniform in [0, n), by multiplying rather than dividing (Lemire); the
+ * bias is below n / 2^32. */
+static inline uint rng_below(rng_t *rng, uint n) {
+  return (uint)(((uint64_t)rng_next(rng) * n) >> 32);
+}
+
+void rng_test();
+
+#endif /* RNG_H */
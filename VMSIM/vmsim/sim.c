@@ -0,0 +1,269 @@
+/*
+ * sim.c - Create simulation instances and feed them references.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <vmsim.h>
+#include <util.h>
+#include <options.h>
+#include <pagetable.h>
+#include <physmem.h>
+#include <stats.h>
+#include <fault.h>
+#include <mrc.h>
+#include <ws.h>
+#include <writeback.h>
+#include <prefetch.h>
+#include <proc.h>
+#include <sim.h>
+
+sim_t *sim_new(const opts_t *config) {
+  sim_t *sim;
+
+  sim = (sim_t*)calloc(1, sizeof(sim_t));
+  assert(sim);
+  sim->opts = *config;
+
+  physmem_init(sim);
+  stats_init(sim);
+  proc_init(sim);
+  /* Under local replacement each process's frames have their own. */
+  if (!sim->opts.local_frames)
+    fault_init(sim);
+  if (sim->opts.mrc)
+    sim->mrc = mrc_new();
+  /* A sweep only reports totals; the window is then just for wsclock. */
+  if (sim->opts.ws_window && !sim->opts.sweep)
+    sim->ws = ws_new(sim->opts.ws_window);
+  if (sim->opts.flush_rate)
+    sim->writeback = writeback_new(&sim->opts);
+  if (sim->opts.tlb_levels)
+    sim->tlb = tlb_new(&sim->opts);
+  if (sim->opts.huge_pagesize)
+    sim->huge = huge_new(&sim->opts);
+  if (sim->opts.interval_every)
+    sim->interval = interval_new(&sim->opts);
+  return sim;
+}
+
+void sim_free(sim_t *sim) {
+  if (sim->interval)
+    interval_free(sim->interval);
+  if (sim->profile)
+    profile_free(sim->profile);
+  if (sim->mrc)
+    mrc_free(sim->mrc);
+  if (sim->ws)
+    ws_free(sim->ws);
+  if (sim->writeback)
+    writeback_free(sim->writeback);
+  if (sim->tlb)
+    tlb_free(sim->tlb);
+  if (sim->huge)
+    huge_free(sim->huge);
+  if (!sim->opts.local_frames)
+    fault_free(sim);
+  proc_free(sim);
+  stats_free(sim);
+  physmem_free(sim);
+  free(sim);
+}
+
+sim_t *sim_partition(sim_t *sim, uint first, uint frames) {
+  sim_t *part;
+
+  assert(first + frames <= sim->opts.phys_pages);
+  part = (sim_t*)calloc(1, sizeof(sim_t));
+  assert(part);
+  part->opts = sim->opts;
+  part->opts.phys_pages = frames;
+  part->physmem = sim->physmem + first;
+  part->frametab.last_use = sim->frametab.last_use + first;
+  part->frametab.load_order = sim->frametab.load_order + first;
+  part->frametab.dirty = sim->frametab.dirty + first;
+  part->stats = sim->stats;
+  part->opt_next = sim->opt_next;
+  part->writeback = sim->writeback;
+  part->tlb = sim->tlb;
+  part->huge = sim->huge;
+  fault_init(part);
+  return part;
+}
+
+void sim_partition_free(sim_t *part) {
+  fault_free(part);
+  free(part);
+}
+
+void sim_warn_addr_bits(vaddr_t vaddr, uint addr_bits) {
+  fprintf(stderr, "vmsim: address 0x%llx does not fit in %u bits; distinct pages will alias (see -a)\n",
+	  vaddr, addr_bits);
+}
+
+void sim_reference(sim_t *sim, const trace_ref_t *ref) {
+  ref_kind_t type = ref->type;
+  proc_t *proc = proc_lookup(sim, &sim->procs, ref->pid);
+  pagetable_t *pt = proc->pagetable;
+  sim_t *frames = proc->frames ? proc->frames : sim;
+  pte_t *pte = NULL;
+  vfn_t vfn;
+  bool_t missed;
+  int prefetched = 0;
+  bool_t walked;
+  PROFILE_VAR(t);
+#ifdef DEBUG
+  char response[20];
+  uint pgfault=FALSE;
+#endif
+
+  stats_reference(sim->stats, type);
+  stats_reference(&proc->stats, type);
+
+  if ((ref->vaddr & ~pt->vaddr_mask) && !sim->warned_addr_bits) {
+    sim_warn_addr_bits(ref->vaddr, pt->addr_bits);
+    sim->warned_addr_bits = TRUE;
+  }
+  vfn = vaddr_to_vfn(ref->vaddr, pt->addr_bits, pt->page_bits);
+  PROFILE_BEGIN(sim->profile, t);
+  if (sim->tlb)
+    pte = tlb_lookup(sim, sim->tlb, proc, vfn);
+  walked = pte == NULL;
+  if (walked) {
+    pte = pagetable_lookup(sim, pt, vfn, type);
+    if (sim->tlb)
+      tlb_walk(sim, pt, pte);
+  }
+  PROFILE_END(sim->profile, PROFILE_LOOKUP, t);
+  if (pte->untouched) {
+    /* The first reference to a page the prefetcher created */
+    pte->untouched = FALSE;
+    if (!pte->valid) {
+      stats_compulsory(sim->stats, type);
+      stats_compulsory(&proc->stats, type);
+    }
+  }
+  if (pte->huge)
+    sim->stats->huge_references++;
+  pte->filled = FALSE;
+  if (sim->mrc)
+    mrc_reference(sim->mrc, pte);
+  if (sim->ws)
+    ws_reference(sim->ws, pte, sim->ref_counter);
+  if (sim->opt_next)
+    pte->next_ref = sim->opt_next[sim->ref_counter];
+#ifdef DEBUG
+    printf("\nGot the count=%dth memory ref with pid:%d mode:%c vaddr:0x%llx vfn:0x%llx\n",
+	sim->ref_counter + 1, ref->pid, trace_kind_char(type), ref->vaddr,
+	pte->vfn);
+      pgfault=!pte->valid;
+      printf("\nGot a page %s. Do you want to dump out the page table and physmem? y or n: ", pgfault? "fault":"hit");
+      scanf("%s", response);
+#endif
+    missed = !pte->valid;
+    if (missed) { /* Fault */
+      stats_miss(sim->stats, type);
+      stats_miss(&proc->stats, type);
+      if (sim->opts.cost)
+	sim->stats->stall_in += sim->opts.page_in_ns;
+      /* Virtual time is the simulation's, not the partition's. */
+      frames->ref_counter = sim->ref_counter;
+      PROFILE_BEGIN(sim->profile, t);
+      sim->opts.fault_handler->handler(frames, pte, type);
+      PROFILE_END(sim->profile, PROFILE_FAULT, t);
+    } else {
+      prefetched = pte->prefetched;
+      pte->prefetched = 0;
+      if (sim->opts.fault_handler->hit) {
+	PROFILE_BEGIN(sim->profile, t);
+	sim->opts.fault_handler->hit(frames, pte, type);
+	PROFILE_END(sim->profile, PROFILE_FAULT, t);
+      }
+    }
+
+    pte->reference = 1;
+    pte->counter = sim->ref_counter++; //used by LRU
+    if (pte->valid)
+      frames->frametab.last_use[pte->pfn] = pte->counter;
+
+    if (type == REF_KIND_STORE) {
+      if (sim->writeback && !pte->modified)
+	writeback_dirty(sim->writeback, pte);
+      pte->modified = TRUE;
+      if (pte->valid)
+	frames->frametab.dirty[pte->pfn] = 1;
+    }
+    if (sim->writeback)
+      writeback_tick(sim);
+    if (sim->huge && missed)
+      huge_fault(sim, proc, pte, type);
+    /* Unless a random victim was this page */
+    if (sim->tlb && walked && pte->valid)
+      tlb_fill(sim->tlb, pte);
+
+    /* Last, as it may evict this page. Promotion above may too. */
+    if (sim->opts.prefetch) {
+      if (missed)
+	prefetch_miss(sim, proc, pte, type);
+      else if (prefetched)
+	prefetch_hit(sim, proc, pte, type, prefetched);
+    }
+    if (sim->interval)
+      interval_tick(sim->interval, sim->stats);
+
+#ifdef DEBUG
+      if (response[0]=='Y' || response[0]=='y') {
+	pagetable_dump(sim, pt);
+	physmem_dump(frames);
+	response[0]='N';
+      }
+#endif
+}
+
+void sim_test_config(opts_t *config, const char *alg, uint frames) {
+  *config = opts;
+  config->test = FALSE;
+  config->verbose = FALSE;
+  config->fault_handler = fault_lookup(alg);
+  config->phys_pages = frames;
+  config->pagesize = 16;
+  config->addr_bits = 16;
+  config->limit = 0;
+  config->local_frames = 0;
+  config->mrc = FALSE;
+  config->ws_window = 0;
+  config->cost = FALSE;
+  config->flush_rate = 0;
+  config->flush_threshold = FLUSH_THRESHOLD_DEFAULT;
+  config->prefetch = PREFETCH_NONE;
+  config->prefetch_pages = 0;
+  config->tlb_levels = 0;
+  config->huge_pagesize = 0;
+  config->huge_promote = HUGE_PROMOTE_DEFAULT;
+  config->sample_k = SAMPLE_K_DEFAULT;
+  config->sample_pool = 0;
+  config->seed = 1;
+  config->seed_runs = 1;
+  config->interval_every = 0;
+  config->interval_faults = FALSE;
+  config->interval_file = NULL;
+  config->sweep = FALSE;
+}
+
+void sim_test_pages(sim_t *sim, const int *pages, int count) {
+  sim_test_refs(sim, pages, NULL, count);
+}
+
+void sim_test_refs(sim_t *sim, const int *pages, const char *kinds,
+		   int count) {
+  trace_ref_t ref = { 1, REF_KIND_LOAD, 0 };
+  int i;
+
+  for (i = 0; i < count; i++) {
+    ref.type = kinds && kinds[i] == 'W' ? REF_KIND_STORE : REF_KIND_LOAD;
+    ref.vaddr = pages[i] * 16;
+    sim_reference(sim, &ref);
+  }
+}
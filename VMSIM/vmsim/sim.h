@@ -0,0 +1,80 @@
+/*
+ * sim.h - A simulation instance: one (fault handler, phys_pages, pagesize)
+ *         configuration plus everything needed to run it - processes and
+ *         their page tables, physical memory, statistics and fault
+ *         handler state. Instances
+ *         share nothing, so a sweep can run many of them at once on
+ *         different threads over the same parsed trace.
+ *
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <vmsim.h>
+#include <options.h>
+#include <pagetable.h>
+#include <physmem.h>
+#include <proc.h>
+#include <stats.h>
+#include <trace.h>
+#include <mrc.h>
+#include <ws.h>
+#include <writeback.h>
+#include <tlb.h>
+#include <huge.h>
+#include <interval.h>
+#include <profile.h>
+
+struct _sim {
+  opts_t opts;          /* this instance's configuration */
+  proctab_t procs;      /* the processes seen so far; see proc.h */
+  pte_t **physmem;      /* opts.phys_pages frames; see physmem.h */
+  frametab_t frametab;  /* their replacement state; see physmem.h */
+  stats_t *stats;
+  void *fault_state;    /* private to opts.fault_handler */
+  mrc_t *mrc;           /* lru-mrc analysis, or NULL */
+  ws_t *ws;             /* working-set size report (-w), or NULL */
+  writeback_t *writeback; /* the flusher (-F), or NULL */
+  tlb_t *tlb;           /* the TLB (-T), or NULL */
+  huge_t *huge;         /* huge page regions (-H), or NULL */
+  interval_t *interval; /* interval statistics (-i), or NULL */
+  profile_t *profile;   /* the replay's own speed, or NULL; see profile.h */
+  const uint *opt_next; /* next-use index for opt, or NULL; see opt.h */
+  int ref_counter;      /* references so far; last-use time for LRU */
+  int fault_counter;    /* loads so far; load order for FIFO */
+  bool_t warned_addr_bits; /* a vaddr wider than opts.addr_bits was seen */
+};
+
+/* Create an instance simulating the configuration in opts. */
+sim_t *sim_new(const opts_t *opts);
+void sim_free(sim_t *sim);
+
+/* A view of frames [first, first + frames) of sim's physmem, for local
+ * replacement: a fault handler given the view sees just those frames,
+ * numbered from 0, and keeps its state in the view. Statistics still go
+ * to sim. */
+sim_t *sim_partition(sim_t *sim, uint first, uint frames);
+void sim_partition_free(sim_t *part);
+
+/* Warn that vaddr is wider than the address space. A sim does so for
+ * the first such reference; a sweep does it once for all of its sims. */
+void sim_warn_addr_bits(vaddr_t vaddr, uint addr_bits);
+
+/* Simulate one memory reference. */
+void sim_reference(sim_t *sim, const trace_ref_t *ref);
+
+/* For self-tests: set config to simulate alg with frames frames of 16
+ * byte pages in a 16-bit address space, every optional feature off, for
+ * the test to adjust before sim_new. */
+void sim_test_config(opts_t *config, const char *alg, uint frames);
+
+/* For self-tests: load the first byte of pages[0..count) of pid 1. */
+void sim_test_pages(sim_t *sim, const int *pages, int count);
+
+/* As sim_test_pages, but the i'th reference is a store if kinds[i] is
+ * 'W', as in the text trace format. */
+void sim_test_refs(sim_t *sim, const int *pages, const char *kinds,
+		   int count);
+
+#endif /* SIM_H */
@@ -5,32 +5,57 @@
 
 #include <stats.h>
 #include <options.h>
-
-stats_t *stats;
+#include <mrc.h>
+#include <ws.h>
+#include <writeback.h>
+#include <huge.h>
+#include <pagetable.h>
+#include <proc.h>
+#include <sim.h>
 
 void stats_output_type(FILE *o, type_count_t output, const char *label);
+void stats_output_cost(sim_t *sim, FILE *o);
+void stats_output_prefetch(sim_t *sim, FILE *o);
+void stats_output_tlb(sim_t *sim, FILE *o);
+
+void stats_init(sim_t *sim) {
+  sim->stats = (stats_t*)calloc(1, sizeof(stats_t));
+  assert(sim->stats);
+}
+
+void stats_free(sim_t *sim) {
+  free(sim->stats);
+  sim->stats = NULL;
+}
 
-void stats_init() {
-  stats = (stats_t*)calloc(1, sizeof(stats_t));
-  assert(stats);
+/* Open opts.output_file for append, or stdout if none was given. */
+FILE *stats_open_output() {
+  FILE *o;
   if (opts.output_file) {
-    stats->output = fopen(opts.output_file, "a+");
-    if (stats->output == NULL) {
+    o = fopen(opts.output_file, "a+");
+    if (o == NULL) {
       perror("vmsim: unable to open output file for write");
       abort();
     }
   } else {
-    stats->output = stdout;
+    o = stdout;
   }
+  return o;
 }
 
-void stats_output() {
-  FILE *o = stats->output;
+void stats_output(sim_t *sim) {
+  stats_t *stats = sim->stats;
+  FILE *o = stats_open_output();
+  proc_t *proc;
+  size_t bytes, reserved;
   fprintf(o, "\n\n Simulation Parameters:"); 
   fprintf(o, "\n    phys_pages, pagesize, input_file, fault_handler, ref_limit\n");
-  fprintf(o, "     %d,  %d,  %s,  %s,  %ld\n", opts.phys_pages, opts.pagesize,
-	  (opts.input_file ? opts.input_file : "stdin"),
-	  opts.fault_handler->name, opts.limit);
+  fprintf(o, "     %d,  %d,  %s,  %s,  %ld\n", sim->opts.phys_pages,
+	  sim->opts.pagesize,
+	  (sim->opts.input_file ? sim->opts.input_file : "stdin"),
+	  sim->opts.fault_handler->name, sim->opts.limit);
+  if (sim->profile)
+    profile_output(sim->profile, proc_pagetable_bytes(sim, &reserved), o);
   
   fprintf(o, "\n Simulation Results:"); 
   fprintf(o, "\n\tStat Type: code,load,store;   total\n");
@@ -38,9 +63,95 @@ void stats_output() {
   stats_output_type(o, stats->miss, "Page Faults");
   stats_output_type(o, stats->compulsory, "Compulsory Page Faults");
   stats_output_type(o, stats->evict_dirty, "(Dirty) Page Writes");
+  bytes = proc_pagetable_bytes(sim, &reserved);
+  fprintf(o, "\tPage Table Memory: %lu bytes (%lu reserved)\n",
+	  (unsigned long)bytes, (unsigned long)reserved);
+
+  if (sim->opts.local_frames)
+    fprintf(o, "\n Per-process Results (local replacement, %d frames each):\n",
+	    sim->opts.local_frames);
+  else
+    fprintf(o, "\n Per-process Results (global replacement):\n");
+  fprintf(o, "\tpid: references, page faults, compulsory page faults, evictions, (dirty) page writes\n");
+  for (proc = sim->procs.list; proc; proc = proc->next) {
+    fprintf(o, "\t%u: %u, %u, %u, %u, %u\n", proc->pid,
+	    stats_total(proc->stats.references), stats_total(proc->stats.miss),
+	    stats_total(proc->stats.compulsory),
+	    stats_total(proc->stats.evictions),
+	    stats_total(proc->stats.evict_dirty));
+  }
+  if (sim->opts.cost)
+    stats_output_cost(sim, o);
+  if (sim->opts.prefetch)
+    stats_output_prefetch(sim, o);
+  if (sim->tlb)
+    stats_output_tlb(sim, o);
+  if (sim->huge)
+    huge_output(sim, o);
+  if (sim->mrc)
+    mrc_output(sim->mrc, o);
+  if (sim->ws)
+    ws_output(sim->ws, o);
 
   fclose(o);
-  stats->output = NULL;
+}
+
+/* Stall time, and the bandwidth of all page writes over the simulated
+ * run time: every reference plus the stalls. */
+void stats_output_cost(sim_t *sim, FILE *o) {
+  stats_t *stats = sim->stats;
+  unsigned long long stall = stats->stall_in + stats->stall_out;
+  unsigned long long elapsed = stall +
+    (unsigned long long)stats_total(stats->references) * sim->opts.ref_ns;
+  count_t writes = stats_total(stats->evict_dirty) + stats->flushed;
+
+  fprintf(o, "\n Write-back Cost (page in %lu ns, page out %lu ns, reference %lu ns):\n",
+	  sim->opts.page_in_ns, sim->opts.page_out_ns, sim->opts.ref_ns);
+  fprintf(o, "\tStall Time: %llu ns (page in %llu, page out %llu)\n", stall,
+	  stats->stall_in, stats->stall_out);
+  if (sim->opts.flush_rate)
+    fprintf(o, "\tFlushed Page Writes: %u (up to %u per %d references over %u%% dirty)\n",
+	    stats->flushed, sim->opts.flush_rate, WRITEBACK_PERIOD,
+	    sim->opts.flush_threshold);
+  fprintf(o, "\tWrite-back Bandwidth: %.3f MB/s (%u pages in %llu ns)\n",
+	  elapsed ? (double)writes * sim->opts.pagesize * 1000 / elapsed : 0.0,
+	  writes, elapsed);
+}
+
+void stats_output_prefetch(sim_t *sim, FILE *o) {
+  static const char *policies[] = { "none", "next", "stride", "adaptive" };
+  stats_t *stats = sim->stats;
+
+  fprintf(o, "\n Prefetching (%s, up to %u pages):\n",
+	  policies[sim->opts.prefetch], sim->opts.prefetch_pages);
+  fprintf(o, "\tPrefetched Pages: %u (useful %u, wasted %u, still unused %u)\n",
+	  stats->prefetched, stats->prefetch_useful, stats->prefetch_wasted,
+	  stats->prefetched - stats->prefetch_useful - stats->prefetch_wasted);
+  fprintf(o, "\tPrefetch Evictions: %u\n", stats->prefetch_evictions);
+}
+
+void stats_output_tlb(sim_t *sim, FILE *o) {
+  static const char *policies[] = { "lru", "fifo", "random" };
+  stats_t *stats = sim->stats;
+  count_t refs = stats_total(stats->references);
+  int l;
+
+  fprintf(o, "\n TLB (");
+  for (l = 0; l < sim->opts.tlb_levels; l++)
+    fprintf(o, "%sL%d %u entries %u-way %s", l ? ", " : "", l + 1,
+	    sim->opts.tlb[l].entries, sim->opts.tlb[l].ways,
+	    policies[sim->opts.tlb[l].policy]);
+  fprintf(o, "):\n");
+  fprintf(o, "\tL1 Hits: %u (%.2f%%)\n", stats->tlb_hits,
+	  refs ? 100.0 * stats->tlb_hits / refs : 0.0);
+  if (sim->opts.tlb_levels > 1)
+    fprintf(o, "\tL2 Hits: %u (%.2f%%)\n", stats->tlb_l2_hits,
+	    refs ? 100.0 * stats->tlb_l2_hits / refs : 0.0);
+  fprintf(o, "\tMisses (Page Walks): %u (%.2f%%), %llu entries read (%.2f per walk)\n",
+	  stats->tlb_misses, refs ? 100.0 * stats->tlb_misses / refs : 0.0,
+	  stats->tlb_walk_levels,
+	  stats->tlb_misses ? (double)stats->tlb_walk_levels / stats->tlb_misses
+	  : 0.0);
 }
 
 void stats_output_type(FILE* o, type_count_t output, const char *label) {
@@ -15,31 +15,52 @@ typedef struct _stats {
   type_count_t compulsory;
   type_count_t evictions;
   type_count_t evict_dirty;
-  FILE *output;
+  count_t resident;  /* frames holding a page now */
+  count_t flushed;   /* pages written back by the flusher (-F) */
+  count_t prefetched;         /* pages brought in by the prefetcher (-P) */
+  count_t prefetch_useful;    /* ... and referenced while resident */
+  count_t prefetch_wasted;    /* ... and evicted unreferenced */
+  count_t prefetch_evictions; /* evictions made to load them */
+  count_t tlb_hits;           /* references translated by the TLB (-T) */
+  count_t tlb_l2_hits;        /* ... by its second level */
+  count_t tlb_misses;         /* page table walks */
+  unsigned long long tlb_walk_levels; /* table entries those walks read */
+  count_t huge_faults;        /* faults that promoted a huge page (-H) */
+  count_t huge_promotions;
+  count_t huge_demotions;
+  count_t huge_references;    /* references to pages of huge pages */
+  count_t huge_filled;        /* pages loaded by promotions */
+  count_t huge_unused;        /* ... and evicted unreferenced */
+  unsigned long long stall_in;  /* ns stalled paging in (-c) */
+  unsigned long long stall_out; /* ns stalled writing dirty victims */
 } stats_t;
 
-extern stats_t *stats;
+void stats_init(sim_t *sim);
+void stats_free(sim_t *sim);
+FILE *stats_open_output();
+void stats_output(sim_t *sim);
 
-void stats_init();
-void stats_output();
+static inline count_t stats_total(type_count_t counts) {
+  return counts[REF_KIND_CODE] + counts[REF_KIND_LOAD] + counts[REF_KIND_STORE];
+}
 
-static inline void stats_compulsory(ref_kind_t type) {
+static inline void stats_compulsory(stats_t *stats, ref_kind_t type) {
   stats->compulsory[type]++;
 }
 
-static inline void stats_reference(ref_kind_t type) {
+static inline void stats_reference(stats_t *stats, ref_kind_t type) {
   stats->references[type]++;
 }
 
-static inline void stats_miss(ref_kind_t type) {
+static inline void stats_miss(stats_t *stats, ref_kind_t type) {
   stats->miss[type]++;
 }
 
-static inline void stats_evict(ref_kind_t type) {
+static inline void stats_evict(stats_t *stats, ref_kind_t type) {
   stats->evictions[type]++;
 }
 
-static inline void stats_evict_dirty(ref_kind_t type) {
+static inline void stats_evict_dirty(stats_t *stats, ref_kind_t type) {
   stats->evict_dirty[type]++;
 }
 
@@ -0,0 +1,437 @@
+/*
+ * sweep.c - Sweep mode. The trace is read into memory once and shared,
+ *           read-only, by a pool of worker threads. Each worker takes the
+ *           next configuration off the job list, runs it as an independent
+ *           sim_t, and keeps only its stats. Rows are printed in job order
+ *           once every job has finished, so the output does not depend on
+ *           scheduling.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include <vmsim.h>
+#include <options.h>
+#include <stats.h>
+#include <trace.h>
+#include <sim.h>
+#include <sweep.h>
+#include <opt.h>
+#include <rng.h>
+
+typedef struct _sweep_job {
+  opts_t opts;   /* the configuration to simulate */
+  const uint *opt_next; /* next-use index, for opt */
+  stats_t stats; /* its results */
+} sweep_job_t;
+
+typedef struct _sweep {
+  const opts_t *config; /* the lists to sweep and what to output */
+  const trace_ref_t *refs;
+  ulong num_refs;
+  sweep_job_t *jobs;
+  int num_jobs;
+  int next_job; /* next job to hand out, protected by lock */
+  pthread_mutex_t lock;
+} sweep_t;
+
+static double sweep_miss_ratio(stats_t *stats) {
+  count_t refs = stats_total(stats->references);
+  return refs ? (double)stats_total(stats->miss) / refs : 0.0;
+}
+
+static void *sweep_worker(void *arg) {
+  sweep_t *sweep = (sweep_t*)arg;
+  sweep_job_t *job;
+  sim_t *sim;
+  ulong i;
+  int next;
+
+  while (1) {
+    pthread_mutex_lock(&sweep->lock);
+    next = sweep->next_job++;
+    pthread_mutex_unlock(&sweep->lock);
+    if (next >= sweep->num_jobs)
+      break;
+
+    job = &sweep->jobs[next];
+    sim = sim_new(&job->opts);
+    /* sweep_refs has already warned of any address too wide */
+    sim->warned_addr_bits = TRUE;
+    sim->opt_next = job->opt_next;
+    for (i = 0; i < sweep->num_refs; i++)
+      sim_reference(sim, &sweep->refs[i]);
+    job->stats = *sim->stats;
+    sim_free(sim);
+  }
+  return NULL;
+}
+
+/* The job with lru in place of job i's algorithm. Jobs are ordered by
+ * algorithm, then page size, then frames, then seed. */
+static sweep_job_t *sweep_lru_job(sweep_t *sweep, int i, int lru) {
+  int per_alg = sweep->num_jobs / sweep->config->num_fault_handlers;
+  return &sweep->jobs[i % per_alg + lru * per_alg];
+}
+
+static bool_t sweep_is_sampled(sweep_job_t *job) {
+  return strcmp(job->opts.fault_handler->name, "sampled-lru") == 0;
+}
+
+/* One row per job. lru is the index of lru among the algorithms if
+ * sampled-lru rows should be compared with it, else -1. */
+static void sweep_output_jobs(sweep_t *sweep, FILE *o, int lru) {
+  const opts_t *config = sweep->config;
+  sweep_job_t *job;
+  int i;
+
+  fprintf(o, "algorithm,phys_pages,pagesize,references,page_faults,"
+	  "compulsory_faults,evictions,dirty_writes%s%s%s%s%s\n",
+	  config->cost ? ",flushed_writes,stall_ns" : "",
+	  config->prefetch ? ",prefetched,prefetch_useful,prefetch_wasted,"
+	  "prefetch_evictions" : "",
+	  config->tlb_levels ? ",tlb_hits,tlb_l2_hits,tlb_misses,tlb_walk_levels"
+	  : "",
+	  config->huge_pagesize ? ",huge_faults,huge_promotions,huge_demotions,"
+	  "huge_references,huge_filled,huge_unused" : "",
+	  lru >= 0 ? ",miss_ratio_vs_lru" : "");
+  for (i = 0; i < sweep->num_jobs; i++) {
+    job = &sweep->jobs[i];
+    fprintf(o, "%s,%d,%d,%u,%u,%u,%u,%u", job->opts.fault_handler->name,
+	    job->opts.phys_pages, job->opts.pagesize,
+	    stats_total(job->stats.references), stats_total(job->stats.miss),
+	    stats_total(job->stats.compulsory),
+	    stats_total(job->stats.evictions),
+	    stats_total(job->stats.evict_dirty));
+    if (config->cost)
+      fprintf(o, ",%u,%llu", job->stats.flushed,
+	      job->stats.stall_in + job->stats.stall_out);
+    if (config->prefetch)
+      fprintf(o, ",%u,%u,%u,%u", job->stats.prefetched,
+	      job->stats.prefetch_useful, job->stats.prefetch_wasted,
+	      job->stats.prefetch_evictions);
+    if (config->tlb_levels)
+      fprintf(o, ",%u,%u,%u,%llu", job->stats.tlb_hits,
+	      job->stats.tlb_l2_hits, job->stats.tlb_misses,
+	      job->stats.tlb_walk_levels);
+    if (config->huge_pagesize)
+      fprintf(o, ",%u,%u,%u,%u,%u,%u", job->stats.huge_faults,
+	      job->stats.huge_promotions, job->stats.huge_demotions,
+	      job->stats.huge_references, job->stats.huge_filled,
+	      job->stats.huge_unused);
+    if (lru >= 0) {
+      if (sweep_is_sampled(job))
+	fprintf(o, ",%+.6f", sweep_miss_ratio(&job->stats) -
+		sweep_miss_ratio(&sweep_lru_job(sweep, i, lru)->stats));
+      else
+	fprintf(o, ",");
+    }
+    fprintf(o, "\n");
+  }
+}
+
+/* Two-sided 95% quantiles of Student's t by degrees of freedom, 1 to 30;
+ * beyond that the normal's 1.96 is close enough. */
+static const double sweep_t95[] = {
+  12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+  2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+  2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+/* The mean of x[0..n) and the half-width of its 95% confidence
+ * interval; n must be at least 2. */
+static double sweep_mean(const double *x, int n, double *ci) {
+  double mean = 0, var = 0;
+  int i;
+
+  for (i = 0; i < n; i++)
+    mean += x[i];
+  mean /= n;
+  for (i = 0; i < n; i++)
+    var += (x[i] - mean) * (x[i] - mean);
+  var /= n - 1;
+  *ci = (n - 1 <= 30 ? sweep_t95[n - 2] : 1.96) * sqrt(var / n);
+  return mean;
+}
+
+/* One row per configuration, over its seed_runs seeds. */
+static void sweep_output_seeds(sweep_t *sweep, FILE *o, int lru) {
+  int runs = sweep->config->seed_runs;
+  double *rate, *delta, mean, ci;
+  sweep_job_t *job;
+  int i, r;
+
+  rate = (double*)malloc(runs * sizeof(double));
+  delta = (double*)malloc(runs * sizeof(double));
+  assert(rate && delta);
+  fprintf(o, "algorithm,phys_pages,pagesize,references,seeds,fault_rate,"
+	  "fault_rate_ci95%s\n",
+	  lru >= 0 ? ",miss_ratio_vs_lru,miss_ratio_vs_lru_ci95" : "");
+  for (i = 0; i < sweep->num_jobs; i += runs) {
+    job = &sweep->jobs[i];
+    for (r = 0; r < runs; r++) {
+      rate[r] = sweep_miss_ratio(&job[r].stats);
+      if (lru >= 0)
+	delta[r] = rate[r] -
+	  sweep_miss_ratio(&sweep_lru_job(sweep, i + r, lru)->stats);
+    }
+    mean = sweep_mean(rate, runs, &ci);
+    fprintf(o, "%s,%d,%d,%u,%d,%.6f,%.6f", job->opts.fault_handler->name,
+	    job->opts.phys_pages, job->opts.pagesize,
+	    stats_total(job->stats.references), runs, mean, ci);
+    if (lru >= 0) {
+      if (sweep_is_sampled(job)) {
+	mean = sweep_mean(delta, runs, &ci);
+	fprintf(o, ",%+.6f,%.6f", mean, ci);
+      } else {
+	fprintf(o, ",,");
+      }
+    }
+    fprintf(o, "\n");
+  }
+  free(rate);
+  free(delta);
+}
+
+/* Simulate every configuration config's lists make over refs and write
+ * the rows to o. */
+static void sweep_refs(const opts_t *config, const trace_ref_t *refs,
+		       ulong num_refs, FILE *o) {
+  sweep_t sweep;
+  pthread_t *threads;
+  sweep_job_t *job;
+  uint **opt_next;
+  int a, p, s, r, i, num_threads, lru, sampled;
+
+  sweep.config = config;
+  sweep.refs = refs;
+  sweep.num_refs = num_refs;
+  /* Every configuration has the same address space, so once will do */
+  for (i = 0; i < num_refs; i++) {
+    if (vaddr_to_vfn(refs[i].vaddr, config->addr_bits, 0) != refs[i].vaddr) {
+      sim_warn_addr_bits(refs[i].vaddr, config->addr_bits);
+      break;
+    }
+  }
+  sweep.num_jobs = config->num_fault_handlers * config->num_pagesizes *
+    config->num_phys_pages * config->seed_runs;
+  sweep.jobs = (sweep_job_t*)calloc(sweep.num_jobs, sizeof(sweep_job_t));
+  assert(sweep.jobs);
+  /* opt's next-use index depends only on the page size; every opt job
+   * with that size shares one. */
+  opt_next = (uint**)calloc(config->num_pagesizes, sizeof(uint*));
+  assert(opt_next);
+  job = sweep.jobs;
+  for (a = 0; a < config->num_fault_handlers; a++) {
+    for (s = 0; s < config->num_pagesizes; s++) {
+      for (p = 0; p < config->num_phys_pages; p++) {
+	for (r = 0; r < config->seed_runs; r++, job++) {
+	  job->opts = *config;
+	  job->opts.fault_handler = config->fault_handler_list[a];
+	  job->opts.pagesize = config->pagesize_list[s];
+	  job->opts.phys_pages = config->phys_pages_list[p];
+	  job->opts.seed = config->seed + r;
+	  if (opt_needed(job->opts.fault_handler)) {
+	    if (opt_next[s] == NULL)
+	      opt_next[s] = opt_index_refs(&job->opts, refs, num_refs);
+	    job->opt_next = opt_next[s];
+	  }
+	}
+      }
+    }
+  }
+  sweep.next_job = 0;
+  pthread_mutex_init(&sweep.lock, NULL);
+
+  num_threads = config->threads < sweep.num_jobs ? config->threads :
+    sweep.num_jobs;
+  if (config->verbose)
+    printf("vmsim: sweeping %d configurations over %lu references on %d threads\n",
+	   sweep.num_jobs, num_refs, num_threads);
+  threads = (pthread_t*)malloc(num_threads * sizeof(pthread_t));
+  assert(threads);
+  for (i = 0; i < num_threads; i++) {
+    if (pthread_create(&threads[i], NULL, sweep_worker, &sweep) != 0) {
+      perror("vmsim: unable to create thread");
+      exit(1);
+    }
+  }
+  for (i = 0; i < num_threads; i++)
+    pthread_join(threads[i], NULL);
+
+  /* With both lru and sampled-lru in the sweep, sampled-lru rows also
+   * give how far their miss ratio is from lru's. */
+  lru = sampled = -1;
+  for (a = 0; a < config->num_fault_handlers; a++) {
+    if (strcmp(config->fault_handler_list[a]->name, "lru") == 0 && lru < 0)
+      lru = a;
+    if (strcmp(config->fault_handler_list[a]->name, "sampled-lru") == 0)
+      sampled = a;
+  }
+  if (sampled < 0)
+    lru = -1;
+
+  if (config->seed_runs > 1)
+    sweep_output_seeds(&sweep, o, lru);
+  else
+    sweep_output_jobs(&sweep, o, lru);
+
+  pthread_mutex_destroy(&sweep.lock);
+  free(threads);
+  free(sweep.jobs);
+  for (s = 0; s < config->num_pagesizes; s++)
+    free(opt_next[s]);
+  free(opt_next);
+}
+
+void sweep_run() {
+  trace_t *trace;
+  trace_ref_t *refs;
+  ulong num_refs;
+  FILE *o;
+
+  trace = trace_open(opts.input_file);
+  refs = trace_load(trace, opts.limit, &num_refs);
+  trace_close(trace);
+
+  o = stats_open_output();
+  sweep_refs(&opts, refs, num_refs, o);
+  fclose(o);
+  free(refs);
+}
+
+/* Faults of alg in frames frames, seeded by seed, over refs[0..n) in a
+ * simulation of its own. */
+static count_t sweep_test_faults(const opts_t *config,
+				 fault_handler_info_t *alg, int frames,
+				 unsigned long long seed,
+				 const trace_ref_t *refs, int n) {
+  opts_t one = *config;
+  count_t faults;
+  sim_t *sim;
+  int i;
+
+  one.fault_handler = alg;
+  one.phys_pages = frames;
+  one.seed = seed;
+  sim = sim_new(&one);
+  for (i = 0; i < n; i++)
+    sim_reference(sim, &refs[i]);
+  faults = stats_total(sim->stats->miss);
+  sim_free(sim);
+  return faults;
+}
+
+/* Sweep fifo, lru and sampled-lru over 3 and 5 frames on 4 threads, then
+ * sampled-lru and lru over 3 seeds, and check every row against runs of
+ * its own. lru is not the first algorithm either time, so the rows it is
+ * compared with are found by index. */
+void sweep_test() {
+  static const double three[] = { 1, 2, 3 };
+  int frames[] = { 3, 5 }, pagesizes[] = { 16 };
+  fault_handler_info_t *algs[3];
+  trace_ref_t refs[500];
+  double rate, ci, delta, delta_ci, x[3], d[3], mean, var;
+  uint pages, pagesize, references, faults;
+  count_t lru_faults;
+  char line[512], name[32];
+  opts_t config;
+  rng_t rng;
+  int a, p, r, i, seeds;
+  FILE *o;
+
+  printf("Testing sweeps\n");
+  /* 2, 1 and 0 from the mean: a variance of 1 and t(2) = 4.303 */
+  mean = sweep_mean(three, 3, &ci);
+  assert(mean == 2 && fabs(ci - 4.303 / sqrt(3)) < 1e-12);
+
+  rng_seed(&rng, 7, 7);
+  for (i = 0; i < 500; i++) {
+    refs[i].pid = 1;
+    refs[i].type = REF_KIND_LOAD;
+    refs[i].vaddr = (rng_below(&rng, 4) ? rng_below(&rng, 6) :
+		     rng_below(&rng, 20)) * 16;
+  }
+  sim_test_config(&config, "lru", 3);
+  config.sample_k = 2;
+  config.threads = 4;
+  config.phys_pages_list = frames;
+  config.num_phys_pages = 2;
+  config.pagesize_list = pagesizes;
+  config.num_pagesizes = 1;
+  config.fault_handler_list = algs;
+
+  algs[0] = fault_lookup("fifo");
+  algs[1] = fault_lookup("lru");
+  algs[2] = fault_lookup("sampled-lru");
+  config.num_fault_handlers = 3;
+  o = tmpfile();
+  assert(o);
+  sweep_refs(&config, refs, 500, o);
+  rewind(o);
+  assert(fgets(line, sizeof(line), o) &&
+	 strstr(line, ",miss_ratio_vs_lru\n"));
+  for (a = 0; a < 3; a++) {
+    for (p = 0; p < 2; p++) {
+      assert(fgets(line, sizeof(line), o));
+      assert(sscanf(line, "%31[^,],%u,%u,%u,%u", name, &pages, &pagesize,
+		    &references, &faults) == 5);
+      assert(strcmp(name, algs[a]->name) == 0 && pages == frames[p] &&
+	     pagesize == 16 && references == 500);
+      assert(faults == sweep_test_faults(&config, algs[a], frames[p], 1,
+					 refs, 500));
+      if (a == 2) {
+	lru_faults = sweep_test_faults(&config, algs[1], frames[p], 1, refs,
+				       500);
+	delta = atof(strrchr(line, ',') + 1);
+	assert(fabs(delta - ((double)faults - lru_faults) / 500) < 1e-6);
+      }
+    }
+  }
+  assert(fgets(line, sizeof(line), o) == NULL);
+  fclose(o);
+
+  algs[0] = fault_lookup("sampled-lru");
+  config.num_fault_handlers = 2;
+  config.seed = 5;
+  config.seed_runs = 3;
+  o = tmpfile();
+  assert(o);
+  sweep_refs(&config, refs, 500, o);
+  rewind(o);
+  assert(fgets(line, sizeof(line), o));
+  for (a = 0; a < 2; a++) {
+    for (p = 0; p < 2; p++) {
+      assert(fgets(line, sizeof(line), o));
+      assert(sscanf(line, "%31[^,],%u,%u,%u,%d,%lf,%lf", name, &pages,
+		    &pagesize, &references, &seeds, &rate, &ci) == 7);
+      assert(strcmp(name, algs[a]->name) == 0 && pages == frames[p] &&
+	     seeds == 3);
+      for (r = 0; r < 3; r++) {
+	x[r] = (double)sweep_test_faults(&config, algs[a], frames[p], 5 + r,
+					 refs, 500) / 500;
+	d[r] = x[r] - (double)sweep_test_faults(&config, algs[1], frames[p],
+						5 + r, refs, 500) / 500;
+      }
+      mean = (x[0] + x[1] + x[2]) / 3;
+      var = ((x[0] - mean) * (x[0] - mean) + (x[1] - mean) * (x[1] - mean) +
+	     (x[2] - mean) * (x[2] - mean)) / 2;
+      assert(fabs(rate - mean) < 1e-6 &&
+	     fabs(ci - 4.303 * sqrt(var / 3)) < 1e-6);
+      if (a == 0) {
+	assert(ci > 0);
+	assert(sscanf(line, "%*[^,],%*u,%*u,%*u,%*d,%*f,%*f,%lf,%lf", &delta,
+		      &delta_ci) == 2);
+	assert(fabs(delta - (d[0] + d[1] + d[2]) / 3) < 1e-6);
+      } else {
+	assert(ci == 0 && strcmp(strchr(line, '\n') - 2, ",,\n") == 0);
+      }
+    }
+  }
+  assert(fgets(line, sizeof(line), o) == NULL);
+  fclose(o);
+}
@@ -0,0 +1,18 @@
+/*
+ * sweep.h - Sweep mode: simulate many configurations over one trace.
+ *
+ */
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+/* Parse opts.input_file once, simulate every combination of
+ * opts.fault_handler_list, opts.phys_pages_list and opts.pagesize_list on
+ * opts.threads threads, and write one CSV row per combination. With
+ * opts.seed_runs > 1 each combination runs that many seeds, and its row
+ * gives the mean fault rate and a 95% confidence interval instead. */
+void sweep_run();
+
+void sweep_test();
+
+#endif /* SWEEP_H */
@@ -0,0 +1,191 @@
+/*
+ * tlb.c - The simulated TLB. See tlb.h.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vmsim.h>
+#include <util.h>
+#include <options.h>
+#include <pagetable.h>
+#include <stats.h>
+#include <proc.h>
+#include <sim.h>
+#include <trace.h>
+#include <tlb.h>
+
+tlb_t *tlb_new(const opts_t *opts) {
+  tlb_t *tlb;
+  tlb_level_t *level;
+  int l;
+
+  assert(opts->tlb_levels > 0 && opts->tlb_levels <= TLB_MAX_LEVELS);
+  tlb = (tlb_t*)calloc(1, sizeof(tlb_t));
+  assert(tlb);
+  tlb->levels = opts->tlb_levels;
+  if (opts->huge_pagesize)
+    tlb->huge_shift = log_2(opts->huge_pagesize / opts->pagesize);
+  for (l = 0; l < tlb->levels; l++) {
+    level = &tlb->level[l];
+    level->ways = opts->tlb[l].ways;
+    level->set_mask = opts->tlb[l].entries / level->ways - 1;
+    level->policy = opts->tlb[l].policy;
+    level->entries = (tlb_entry_t*)calloc(opts->tlb[l].entries,
+					  sizeof(tlb_entry_t));
+    assert(level->entries);
+    rng_seed(&level->rng, opts->seed, RNG_STREAM_TLB + l);
+  }
+  return tlb;
+}
+
+void tlb_free(tlb_t *tlb) {
+  int l;
+  for (l = 0; l < tlb->levels; l++)
+    free(tlb->level[l].entries);
+  free(tlb);
+}
+
+/* The ways of the set vfn maps to. */
+static inline tlb_entry_t *tlb_set(tlb_level_t *level, vfn_t vfn) {
+  return level->entries + (size_t)(vfn & level->set_mask) * level->ways;
+}
+
+static inline tlb_entry_t *tlb_find(tlb_level_t *level, proc_t *proc,
+				    vfn_t vfn, bool_t huge) {
+  tlb_entry_t *e = tlb_set(level, vfn), *end = e + level->ways;
+
+  for (; e < end; e++)
+    if (e->vfn == vfn && e->proc == proc && e->huge == huge)
+      return e;
+  return NULL;
+}
+
+/* Put the translation of tag vfn, for pte, in its set at level, in an
+ * empty way if there is one. */
+static void tlb_insert(tlb_level_t *level, vfn_t vfn, bool_t huge, pte_t *pte,
+		       ulong now) {
+  tlb_entry_t *set = tlb_set(level, vfn), *victim = NULL;
+  uint i;
+
+  for (i = 0; i < level->ways; i++) {
+    if (set[i].proc == NULL) {
+      victim = &set[i];
+      break;
+    }
+  }
+  if (victim == NULL) {
+    if (level->policy == TLB_RANDOM) {
+      victim = &set[rng_below(&level->rng, level->ways)];
+    } else {
+      /* LRU and FIFO differ only in when the stamp is set */
+      victim = set;
+      for (i = 1; i < level->ways; i++)
+	if (set[i].stamp < victim->stamp)
+	  victim = &set[i];
+    }
+  }
+  victim->vfn = vfn;
+  victim->proc = pte->proc;
+  victim->huge = huge;
+  victim->pte = pte;
+  victim->stamp = now;
+}
+
+pte_t *tlb_lookup(sim_t *sim, tlb_t *tlb, proc_t *proc, vfn_t vfn) {
+  tlb_level_t *level;
+  tlb_entry_t *e;
+  int l;
+
+  tlb->clock++;
+  for (l = 0; l < tlb->levels; l++) {
+    level = &tlb->level[l];
+    e = tlb_find(level, proc, vfn, FALSE);
+    if (e == NULL && tlb->huge_shift)
+      e = tlb_find(level, proc, vfn >> tlb->huge_shift, TRUE);
+    if (e == NULL)
+      continue;
+    if (level->policy == TLB_LRU)
+      e->stamp = tlb->clock;
+    if (l == 0) {
+      sim->stats->tlb_hits++;
+    } else {
+      sim->stats->tlb_l2_hits++;
+      tlb_insert(&tlb->level[0], e->vfn, e->huge, e->pte, tlb->clock);
+    }
+    if (e->huge && e->pte->vfn != vfn)
+      return pagetable_lookup(sim, proc->pagetable, vfn, REF_KIND_PREFETCH);
+    return e->pte;
+  }
+  sim->stats->tlb_misses++;
+  return NULL;
+}
+
+void tlb_walk(sim_t *sim, pagetable_t *pt, pte_t *pte) {
+  /* A huge page is mapped by the level above the leaves. */
+  sim->stats->tlb_walk_levels += pte->huge && pt->walk_levels > 1 ?
+    pt->walk_levels - 1 : pt->walk_levels;
+}
+
+void tlb_fill(tlb_t *tlb, pte_t *pte) {
+  vfn_t vfn = pte->huge ? pte->vfn >> tlb->huge_shift : pte->vfn;
+  int l;
+
+  for (l = 0; l < tlb->levels; l++)
+    tlb_insert(&tlb->level[l], vfn, pte->huge, pte, tlb->clock);
+}
+
+void tlb_invalidate(tlb_t *tlb, pte_t *pte) {
+  tlb_entry_t *e;
+  int l;
+
+  for (l = 0; l < tlb->levels; l++) {
+    e = tlb_find(&tlb->level[l], pte->proc, pte->vfn, FALSE);
+    if (e)
+      e->proc = NULL;
+    if (!pte->huge)
+      continue;
+    e = tlb_find(&tlb->level[l], pte->proc, pte->vfn >> tlb->huge_shift,
+		 TRUE);
+    if (e)
+      e->proc = NULL;
+  }
+}
+
+/* Run pages[] through a 3 frame LRU simulation with a 4 entry first level
+ * of the given associativity. */
+static sim_t *tlb_test_run(const int *pages, int count, uint ways) {
+  opts_t config;
+  sim_t *sim;
+
+  sim_test_config(&config, "lru", 3);
+  config.tlb_levels = 1;
+  config.tlb[0].entries = 4;
+  config.tlb[0].ways = ways;
+  config.tlb[0].policy = TLB_LRU;
+  sim = sim_new(&config);
+  sim_test_pages(sim, pages, count);
+  return sim;
+}
+
+void tlb_test() {
+  /* Pages 0 and 4 share a set of the direct-mapped TLB */
+  static const int conflict[] = { 0, 4, 0, 4, 0, 4 };
+  /* Loading 3 evicts 1, whose translation must not survive */
+  static const int evict[] = { 0, 1, 2, 0, 2, 3, 1 };
+  sim_t *sim;
+
+  printf("Testing TLB\n");
+  sim = tlb_test_run(conflict, 6, 1);
+  assert(sim->stats->tlb_hits == 0 && sim->stats->tlb_misses == 6);
+  sim_free(sim);
+  sim = tlb_test_run(conflict, 6, 2);
+  assert(sim->stats->tlb_hits == 4 && sim->stats->tlb_misses == 2);
+  sim_free(sim);
+
+  sim = tlb_test_run(evict, 7, 4);
+  assert(sim->stats->tlb_hits == 2 && sim->stats->tlb_misses == 5);
+  assert(stats_total(sim->stats->miss) == 5);
+  sim_free(sim);
+}
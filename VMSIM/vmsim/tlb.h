@@ -0,0 +1,69 @@
+/*
+ * tlb.h - A simulated TLB in front of the page tables (-T).
+ *
+ *         One or two levels of set-associative vfn -> pte_t caches,
+ *         shared by every process and tagged with the process, as with
+ *         ASIDs. A reference looks in the first level, then the second;
+ *         missing both is a page table walk, which reads one entry per
+ *         level of the process's table. Only resident pages are cached:
+ *         a walk that faults fills the TLB once the page is loaded, and
+ *         physmem_evict invalidates the page everywhere. With huge pages
+ *         (-H) one entry translates a whole huge page.
+ *
+ *         A hit skips the page table lookup, so a small TLB is also a
+ *         fast path for radix and hashed tables.
+ */
+
+#ifndef TLB_H
+#define TLB_H
+
+#include <stdlib.h>
+
+#include <vmsim.h>
+#include <options.h>
+#include <pagetable.h>
+#include <rng.h>
+
+typedef struct _tlb_entry {
+  vfn_t vfn;      /* or for a huge page, vfn >> tlb->huge_shift */
+  proc_t *proc;   /* NULL if the entry is empty */
+  bool_t huge;
+  pte_t *pte;
+  ulong stamp;    /* last use (LRU) or fill (FIFO) */
+} tlb_entry_t;
+
+typedef struct _tlb_level {
+  tlb_entry_t *entries; /* sets * ways, a set's ways together */
+  uint set_mask;        /* sets - 1; sets is a power of 2 */
+  uint ways;
+  tlb_policy_t policy;
+  rng_t rng;            /* TLB_RANDOM victims */
+} tlb_level_t;
+
+typedef struct _tlb {
+  int levels;
+  tlb_level_t level[TLB_MAX_LEVELS];
+  ulong clock;    /* lookups so far; the stamps' time */
+  uint huge_shift; /* log_2(base pages per huge page), 0 if none */
+} tlb_t;
+
+/* Build the TLB described by opts->tlb; opts->tlb_levels must be > 0. */
+tlb_t *tlb_new(const opts_t *opts);
+void tlb_free(tlb_t *tlb);
+
+/* Translate vfn of proc. Returns its pte_t on a hit, refilling the first
+ * level from the second; NULL on a miss. */
+pte_t *tlb_lookup(sim_t *sim, tlb_t *tlb, proc_t *proc, vfn_t vfn);
+
+/* Count the walk of pt that found pte after a miss. */
+void tlb_walk(sim_t *sim, pagetable_t *pt, pte_t *pte);
+
+/* Cache pte, now resident, in every level after a walk. */
+void tlb_fill(tlb_t *tlb, pte_t *pte);
+
+/* pte is being evicted; drop it, and its huge page, from every level. */
+void tlb_invalidate(tlb_t *tlb, pte_t *pte);
+
+void tlb_test();
+
+#endif /* TLB_H */
@@ -0,0 +1,514 @@
+/*
+ * trace.c - Open memory reference traces and decode them one
+ *           reference at a time. See trace.h for the formats.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <vmsim.h>
+#include <util.h>
+#include <trace.h>
+
+static void trace_map_binary(trace_t *trace);
+static void trace_fill(trace_t *trace);
+static int trace_parse_line(char *p, trace_ref_t *ref);
+
+/* Value of each hex digit, or 0xff for characters that are not one. */
+static byte_t hex_value[256];
+
+trace_t *trace_open(const char *path) {
+  trace_t *trace;
+  trace_header_t header;
+  struct stat st;
+  int i;
+
+  for (i = 0; i < 256; i++)
+    hex_value[i] = 0xff;
+  for (i = 0; i < 10; i++)
+    hex_value['0' + i] = i;
+  for (i = 0; i < 6; i++)
+    hex_value['a' + i] = hex_value['A' + i] = 10 + i;
+
+  trace = (trace_t*)calloc(1, sizeof(trace_t));
+  assert(trace);
+  /* One spare byte so the last line can always be '\n'-terminated. */
+  trace->buf = (char*)malloc(TRACE_BUFSIZE + 1);
+  assert(trace->buf);
+  trace->pos = trace->lim = trace->buf;
+
+  if (path == NULL || strcmp(path, "-") == 0) {
+    trace->name = "stdin";
+    trace->fd = STDIN_FILENO;
+  } else {
+    trace->name = path;
+    if ((trace->fd = open(path, O_RDONLY)) == -1) {
+      fprintf(stderr, "vmsim: could not open input file %s\n", path);
+      exit(1);
+    }
+  }
+
+  trace_fill(trace);
+  if (trace->lim - trace->pos >= sizeof(header) &&
+      memcmp(trace->pos, TRACE_MAGIC, sizeof(header.magic)) == 0) {
+    memcpy(&header, trace->pos, sizeof(header));
+    if (file_to_host_uint(header.byte_order) != TRACE_BYTE_ORDER) {
+      fprintf(stderr, "vmsim: %s: binary trace has an unknown byte order\n",
+	      trace->name);
+      exit(1);
+    }
+    trace->version = file_to_host_uint(header.version);
+    if (trace->version == 1) {
+      trace->rec_size = sizeof(trace_rec_t);
+    } else if (trace->version == 2) {
+      trace->rec_size = sizeof(trace_rec64_t);
+    } else {
+      fprintf(stderr, "vmsim: %s: unsupported binary trace version %u\n",
+	      trace->name, trace->version);
+      exit(1);
+    }
+    if (fstat(trace->fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+      fprintf(stderr, "vmsim: %s: binary traces must be read from a file\n",
+	      trace->name);
+      exit(1);
+    }
+    trace_map_binary(trace);
+  }
+  return trace;
+}
+
+/* Map the whole file read-only and point next/end at the records. */
+void trace_map_binary(trace_t *trace) {
+  struct stat st;
+  size_t nrecs;
+
+  if (fstat(trace->fd, &st) == -1) {
+    perror("vmsim: unable to stat input file");
+    exit(1);
+  }
+  trace->map_len = st.st_size;
+  nrecs = (trace->map_len - sizeof(trace_header_t)) / trace->rec_size;
+  if (sizeof(trace_header_t) + nrecs * trace->rec_size != trace->map_len) {
+    fprintf(stderr, "vmsim: %s: binary trace is truncated\n", trace->name);
+    exit(1);
+  }
+
+  trace->map = mmap(NULL, trace->map_len, PROT_READ, MAP_PRIVATE,
+		    trace->fd, 0);
+  if (trace->map == MAP_FAILED) {
+    perror("vmsim: unable to map input file");
+    exit(1);
+  }
+  madvise(trace->map, trace->map_len, MADV_SEQUENTIAL);
+
+  trace->next = (const char*)trace->map + sizeof(trace_header_t);
+  trace->end = trace->next + nrecs * trace->rec_size;
+}
+
+void trace_bad_record(const trace_t *trace) {
+  const char *first = (const char*)trace->map + sizeof(trace_header_t);
+
+  fprintf(stderr, "vmsim: %s: bad record %lu\n", trace->name,
+	  (ulong)((trace->next - first) / trace->rec_size + 1));
+  exit(1);
+}
+
+void trace_close(trace_t *trace) {
+  if (trace->map)
+    munmap(trace->map, trace->map_len);
+  if (trace->fd != STDIN_FILENO)
+    close(trace->fd);
+  free(trace->buf);
+  free(trace);
+}
+
+/* Move the unparsed tail of the buffer to the front and read another
+ * block after it. Sets eof once read() reports end of file. */
+void trace_fill(trace_t *trace) {
+  size_t left = trace->lim - trace->pos;
+  ssize_t n;
+
+  if (left == TRACE_BUFSIZE) {
+    fprintf(stderr, "vmsim: %s:%lu: line too long\n", trace->name,
+	    trace->line + 1);
+    exit(1);
+  }
+  memmove(trace->buf, trace->pos, left);
+  trace->pos = trace->buf;
+  trace->lim = trace->buf + left;
+
+  do {
+    n = read(trace->fd, trace->lim, TRACE_BUFSIZE - left);
+  } while (n == -1 && errno == EINTR);
+  if (n == -1) {
+    perror("vmsim: error reading input");
+    exit(1);
+  }
+  if (n == 0)
+    trace->eof = TRUE;
+  trace->lim += n;
+}
+
+static inline bool_t trace_is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+/* Parse one '\n'-terminated line. Returns 1 if a reference was stored in
+ * ref, 0 for a blank line and -1 if the line is malformed. The '\n' is
+ * never a digit, hex digit or space, so it stops every scan below. */
+int trace_parse_line(char *p, trace_ref_t *ref) {
+  unsigned long long pid = 0;
+  vaddr_t vaddr = 0;
+  byte_t digit;
+  char *start;
+
+  while (trace_is_space(*p)) p++;
+  if (*p == '\n')
+    return 0;
+
+  start = p;
+  while ((uint)(*p - '0') < 10) {
+    pid = pid * 10 + (*p++ - '0');
+    if (pid > UINT_MAX)
+      return -1;
+  }
+  if (p == start)
+    return -1;
+
+  while (trace_is_space(*p)) p++;
+  if (*p++ != ',')
+    return -1;
+  while (trace_is_space(*p)) p++;
+  switch (*p++) {
+  case 'R': ref->type = REF_KIND_LOAD; break;
+  case 'W': ref->type = REF_KIND_STORE; break;
+  case 'I': ref->type = REF_KIND_CODE; break;
+  default: return -1;
+  }
+  while (trace_is_space(*p)) p++;
+  if (*p++ != ',')
+    return -1;
+  while (trace_is_space(*p)) p++;
+
+  if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+    p += 2;
+  start = p;
+  while ((digit = hex_value[(byte_t)*p]) != 0xff) {
+    vaddr = vaddr << 4 | digit;
+    p++;
+  }
+  if (p == start || p - start > 2 * sizeof(vaddr_t))
+    return -1;
+
+  while (trace_is_space(*p)) p++;
+  if (*p != '\n')
+    return -1;
+
+  ref->pid = (uint)pid;
+  ref->vaddr = vaddr;
+  return 1;
+}
+
+bool_t trace_next_text(trace_t *trace, trace_ref_t *ref) {
+  char *nl;
+  int parsed;
+
+  while (1) {
+    nl = memchr(trace->pos, '\n', trace->lim - trace->pos);
+    if (nl == NULL) {
+      if (!trace->eof) {
+	trace_fill(trace);
+	continue;
+      }
+      if (trace->pos == trace->lim)
+	return FALSE;
+      /* Last line has no newline; terminate it in the spare byte. */
+      nl = trace->lim;
+      *nl = '\n';
+    }
+
+    trace->line++;
+    parsed = trace_parse_line(trace->pos, ref);
+    trace->pos = nl < trace->lim ? nl + 1 : trace->lim;
+    if (parsed == 1)
+      return TRUE;
+    if (parsed == -1) {
+      fprintf(stderr, "vmsim: %s:%lu: malformed trace line\n", trace->name,
+	      trace->line);
+      exit(1);
+    }
+  }
+}
+
+trace_ref_t *trace_load(trace_t *trace, long limit, ulong *count) {
+  trace_ref_t *refs;
+  ulong n = 0, capacity;
+
+  if (trace->map)
+    capacity = (trace->end - trace->next) / trace->rec_size;
+  else
+    capacity = 1 << 16;
+  if (limit && capacity > limit)
+    capacity = limit;
+  if (capacity == 0)
+    capacity = 1;
+  refs = (trace_ref_t*)malloc(capacity * sizeof(trace_ref_t));
+  assert(refs);
+
+  while ((limit == 0 || n < limit) && trace_next(trace, &refs[n])) {
+    if (++n == capacity) {
+      capacity *= 2;
+      refs = (trace_ref_t*)realloc(refs, capacity * sizeof(trace_ref_t));
+      assert(refs);
+    }
+  }
+  *count = n;
+  return refs;
+}
+
+void trace_write_header(FILE *fout) {
+  trace_header_t header;
+
+  memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+  header.version = host_to_file_uint(TRACE_VERSION);
+  header.byte_order = host_to_file_uint(TRACE_BYTE_ORDER);
+  header.reserved = 0;
+  fwrite(&header, sizeof(header), 1, fout);
+}
+
+bool_t trace_write_ref(FILE *fout, const trace_ref_t *ref) {
+  trace_rec64_t rec;
+
+  if (ref->pid > TRACE_MAX_PID)
+    return FALSE;
+  rec.vaddr_lo = host_to_file_uint((uint)ref->vaddr);
+  rec.vaddr_hi = host_to_file_uint((uint)(ref->vaddr >> 32));
+  rec.info = host_to_file_uint(ref->pid << TRACE_KIND_BITS | ref->type);
+  fwrite(&rec, sizeof(rec), 1, fout);
+  return TRUE;
+}
+
+char trace_kind_char(ref_kind_t type) {
+  if (type == REF_KIND_LOAD) return 'R';
+  if (type == REF_KIND_STORE) return 'W';
+  return 'I';
+}
+
+/* A new temporary file, named in path, open for writing. */
+static FILE *trace_test_create(char *path) {
+  FILE *f;
+  int fd;
+
+  fd = mkstemp(path);
+  assert(fd >= 0);
+  f = fdopen(fd, "w");
+  assert(f);
+  return f;
+}
+
+/* Read the trace at path, or with from_stdin the one on stdin with path
+ * redirected to it, to the end in a child process. The child must exit
+ * with status 1, having printed want to stderr. */
+static void trace_test_error(const char *path, bool_t from_stdin,
+			     const char *want) {
+  char err[] = "/tmp/vmsim-traceXXXXXX", msg[512];
+  trace_ref_t ref;
+  trace_t *trace;
+  int fd, status;
+  ssize_t n;
+  pid_t pid;
+
+  fd = mkstemp(err);
+  assert(fd >= 0);
+  fflush(stdout);
+  fflush(stderr);
+  pid = fork();
+  assert(pid >= 0);
+  if (pid == 0) {
+    dup2(fd, STDERR_FILENO);
+    if (from_stdin) {
+      dup2(open(path, O_RDONLY), STDIN_FILENO);
+      path = "-";
+    }
+    trace = trace_open(path);
+    while (trace_next(trace, &ref))
+      ;
+    _exit(0);
+  }
+  assert(waitpid(pid, &status, 0) == pid);
+  assert(WIFEXITED(status) && WEXITSTATUS(status) == 1);
+  n = pread(fd, msg, sizeof(msg) - 1, 0);
+  assert(n >= 0);
+  msg[n] = '\0';
+  assert(strcmp(msg, want) == 0);
+  close(fd);
+  unlink(err);
+}
+
+/* A binary trace header of the given magic and version. */
+static void trace_test_header(FILE *f, const char *magic, uint version) {
+  trace_header_t header;
+
+  memcpy(header.magic, magic, sizeof(header.magic));
+  header.version = host_to_file_uint(version);
+  header.byte_order = host_to_file_uint(TRACE_BYTE_ORDER);
+  header.reserved = 0;
+  fwrite(&header, sizeof(header), 1, f);
+}
+
+/* Check that the trace at path holds just refs[0..count). */
+static void trace_test_read(const char *path, const trace_ref_t *refs,
+			    int count) {
+  trace_t *trace = trace_open(path);
+  trace_ref_t ref;
+  int i;
+
+  for (i = 0; i < count; i++) {
+    assert(trace_next(trace, &ref));
+    assert(ref.pid == refs[i].pid && ref.type == refs[i].type &&
+	   ref.vaddr == refs[i].vaddr);
+  }
+  assert(!trace_next(trace, &ref));
+  trace_close(trace);
+}
+
+void trace_test() {
+  static const trace_ref_t refs[] = {
+    { 1, REF_KIND_LOAD, 0x1000 },
+    { 7, REF_KIND_CODE, 0xffffffff },
+    { TRACE_MAX_PID, REF_KIND_STORE, 0xfedcba9876543210ULL },
+    { 0, REF_KIND_LOAD, 0x100000000ULL }
+  };
+  /* No kind, a 17 digit address, a second address, and pids past
+   * UINT_MAX */
+  static const char *bad[] = { "1, 0x10\n", "1, R, 0x1fedcba9876543210\n",
+			       "1, R, 0x10 0x20\n", "4294967296, R, 0x10\n",
+			       "99999999999, R, 0x10\n" };
+  char path[] = "/tmp/vmsim-traceXXXXXX", want[512];
+  trace_ref_t ref;
+  trace_rec64_t rec64;
+  trace_rec_t rec;
+  trace_t *trace;
+  FILE *f;
+  int i;
+
+  printf("Testing binary traces\n");
+  /* What vmsim-convert writes reads back, 64-bit addresses and all */
+  f = trace_test_create(path);
+  trace_write_header(f);
+  for (i = 0; i < 4; i++)
+    trace_write_ref(f, &refs[i]);
+  /* A pid that would spill into the kind bits is not written */
+  ref = refs[0];
+  ref.pid = TRACE_MAX_PID + 1;
+  assert(!trace_write_ref(f, &ref));
+  fclose(f);
+  trace = trace_open(path);
+  assert(trace->map && trace->version == TRACE_VERSION);
+  trace_close(trace);
+  trace_test_read(path, refs, 4);
+  /* A kind that is none of R, W and I */
+  f = fopen(path, "a");
+  assert(f);
+  rec64.vaddr_lo = rec64.vaddr_hi = 0;
+  rec64.info = host_to_file_uint(1 << TRACE_KIND_BITS | TRACE_KIND_MASK);
+  fwrite(&rec64, sizeof(rec64), 1, f);
+  fclose(f);
+  snprintf(want, sizeof(want), "vmsim: %s: bad record 5\n", path);
+  trace_test_error(path, FALSE, want);
+  /* Half a record short */
+  assert(truncate(path, sizeof(trace_header_t) +
+		  5 * sizeof(trace_rec64_t) - 6) == 0);
+  snprintf(want, sizeof(want), "vmsim: %s: binary trace is truncated\n",
+	   path);
+  trace_test_error(path, FALSE, want);
+  unlink(path);
+
+  /* Version 1 files, of 32-bit addresses, still read */
+  strcpy(path, "/tmp/vmsim-traceXXXXXX");
+  f = trace_test_create(path);
+  trace_test_header(f, TRACE_MAGIC, 1);
+  for (i = 0; i < 2; i++) {
+    rec.vaddr = host_to_file_uint((uint)refs[i].vaddr);
+    rec.info = host_to_file_uint(refs[i].pid << TRACE_KIND_BITS |
+				 refs[i].type);
+    fwrite(&rec, sizeof(rec), 1, f);
+  }
+  fclose(f);
+  trace = trace_open(path);
+  assert(trace->map && trace->version == 1);
+  trace_close(trace);
+  trace_test_read(path, refs, 2);
+  unlink(path);
+
+  /* Without the magic number a file is text, which this is not */
+  strcpy(path, "/tmp/vmsim-traceXXXXXX");
+  f = trace_test_create(path);
+  trace_test_header(f, "VMTX", TRACE_VERSION);
+  trace_write_ref(f, &refs[0]);
+  fclose(f);
+  snprintf(want, sizeof(want), "vmsim: %s:1: malformed trace line\n", path);
+  trace_test_error(path, FALSE, want);
+  unlink(path);
+
+  /* With it, a version from the future is refused */
+  strcpy(path, "/tmp/vmsim-traceXXXXXX");
+  f = trace_test_create(path);
+  trace_test_header(f, TRACE_MAGIC, TRACE_VERSION + 1);
+  fclose(f);
+  snprintf(want, sizeof(want),
+	   "vmsim: %s: unsupported binary trace version %u\n", path,
+	   TRACE_VERSION + 1);
+  trace_test_error(path, FALSE, want);
+  unlink(path);
+
+  printf("Testing text traces\n");
+  /* Blank lines and surrounding whitespace go; the last line need not
+   * end in a newline */
+  strcpy(path, "/tmp/vmsim-traceXXXXXX");
+  f = trace_test_create(path);
+  fputs("1, R, 0x1000 \n\n  \t\r\n\t7 ,I,  ffffffff\t\r\n", f);
+  fprintf(f, "%u, W, 0xFEDCBA9876543210\r\n", TRACE_MAX_PID);
+  fputs("0,R,0x100000000", f);
+  fclose(f);
+  trace_test_read(path, refs, 4);
+  unlink(path);
+
+  /* Errors in bad[] give the line, counting blank ones */
+  for (i = 0; i < (int)(sizeof(bad) / sizeof(bad[0])); i++) {
+    strcpy(path, "/tmp/vmsim-traceXXXXXX");
+    f = trace_test_create(path);
+    fprintf(f, "\n%s1, R, 0x10\n", bad[i]);
+    fclose(f);
+    snprintf(want, sizeof(want), "vmsim: %s:2: malformed trace line\n",
+	     path);
+    trace_test_error(path, FALSE, want);
+    if (i == 0)
+      trace_test_error(path, TRUE, "vmsim: stdin:2: malformed trace line\n");
+    unlink(path);
+  }
+
+  /* 17 byte lines do not divide TRACE_BUFSIZE, so one of them straddles
+   * the first block and must be joined up with the rest of it */
+  strcpy(path, "/tmp/vmsim-traceXXXXXX");
+  f = trace_test_create(path);
+  for (i = 0; i < TRACE_BUFSIZE / 17 + 100; i++)
+    fprintf(f, "%u, %c, 0x%08x\n", i % 10, i % 2 ? 'R' : 'W', i);
+  fclose(f);
+  trace = trace_open(path);
+  for (i = 0; trace_next(trace, &ref); i++)
+    assert(ref.pid == i % 10 && ref.vaddr == i &&
+	   ref.type == (i % 2 ? REF_KIND_LOAD : REF_KIND_STORE));
+  assert(i == TRACE_BUFSIZE / 17 + 100 && trace->line == i);
+  trace_close(trace);
+  unlink(path);
+}
@@ -0,0 +1,137 @@
+/*
+ * trace.h - Reading memory reference traces.
+ *
+ * Two formats are understood:
+ *  - text: one "pid, R|W|I, 0xADDR" reference per line (trace*.txt).
+ *    Text is read in large blocks and tokenized by hand; blank lines and
+ *    trailing whitespace are ignored and anything else that does not
+ *    parse is reported with its line number.
+ *  - binary: a trace_header_t followed by fixed-width records,
+ *    little-endian on disk: trace_rec_t with 32-bit addresses in version
+ *    1 files, trace_rec64_t with 64-bit addresses from version 2 on.
+ *    Binary traces are mmap'ed and walked in place, so replaying one
+ *    costs no parsing and no copying. Use vmsim-convert to produce them
+ *    from text traces; it writes the current version.
+ *
+ * trace_open looks at the magic number to pick the format. A NULL or "-"
+ * path reads a text trace from stdin.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <vmsim.h>
+#include <util.h>
+
+#define TRACE_MAGIC "VMTB"
+#define TRACE_VERSION 2
+/* Written through host_to_file_uint; reads back as this value only if
+ * the file and host byte orders were reconciled correctly. */
+#define TRACE_BYTE_ORDER 0x01020304
+
+typedef struct _trace_header {
+  char magic[4];
+  uint version;
+  uint byte_order;
+  uint reserved; /* pads the header to 16 bytes */
+} trace_header_t;
+
+/* Version 1 records. */
+typedef struct _trace_rec {
+  uint vaddr;
+  uint info; /* pid << TRACE_KIND_BITS | ref_kind_t */
+} trace_rec_t;
+
+/* Version 2 records. The address is split into two uints so records
+ * need only 4-byte alignment and swap with file_to_host_uint. */
+typedef struct _trace_rec64 {
+  uint vaddr_lo;
+  uint vaddr_hi;
+  uint info;
+} trace_rec64_t;
+
+#define TRACE_KIND_BITS 2
+#define TRACE_KIND_MASK ((1 << TRACE_KIND_BITS) - 1)
+#define TRACE_MAX_PID ((uint)-1 >> TRACE_KIND_BITS)
+
+/* One decoded memory reference. */
+typedef struct _trace_ref {
+  uint pid;
+  ref_kind_t type;
+  vaddr_t vaddr;
+} trace_ref_t;
+
+/* Size of the blocks text traces are read in. Also bounds line length. */
+#define TRACE_BUFSIZE (1 << 20)
+
+typedef struct _trace {
+  const char *name;
+  int fd;
+  /* text traces: buf holds [pos, lim) still to be parsed */
+  char *buf;
+  char *pos;
+  char *lim;
+  ulong line;
+  bool_t eof;
+  /* binary traces: the mapped file and the next record to return */
+  void *map;
+  size_t map_len;
+  uint version;
+  size_t rec_size;
+  const char *next;
+  const char *end;
+} trace_t;
+
+/* Open the named trace. Exits with an error message if it cannot be
+ * opened or has a bad binary header. */
+trace_t *trace_open(const char *path);
+void trace_close(trace_t *trace);
+
+bool_t trace_next_text(trace_t *trace, trace_ref_t *ref);
+/* Exit with an error naming the binary record at trace->next. */
+void trace_bad_record(const trace_t *trace);
+
+/* Fetch the next reference into ref. Returns FALSE at end of trace. */
+static inline bool_t trace_next(trace_t *trace, trace_ref_t *ref) {
+  const trace_rec64_t *rec64;
+  const trace_rec_t *rec;
+  uint info;
+
+  if (trace->map == NULL)
+    return trace_next_text(trace, ref);
+  if (trace->next == trace->end)
+    return FALSE;
+  if (trace->version == 1) {
+    rec = (const trace_rec_t*)trace->next;
+    info = file_to_host_uint(rec->info);
+    ref->vaddr = file_to_host_uint(rec->vaddr);
+  } else {
+    rec64 = (const trace_rec64_t*)trace->next;
+    info = file_to_host_uint(rec64->info);
+    ref->vaddr = (vaddr_t)file_to_host_uint(rec64->vaddr_hi) << 32 |
+      file_to_host_uint(rec64->vaddr_lo);
+  }
+  if ((info & TRACE_KIND_MASK) >= REF_KIND_NUM)
+    trace_bad_record(trace);
+  ref->pid = info >> TRACE_KIND_BITS;
+  ref->type = (ref_kind_t)(info & TRACE_KIND_MASK);
+  trace->next += trace->rec_size;
+  return TRUE;
+}
+
+/* Read the rest of the trace, or its first limit references if limit is
+ * not 0, into a new array. The number of references is stored in count. */
+trace_ref_t *trace_load(trace_t *trace, long limit, ulong *count);
+
+/* Writing binary traces, used by vmsim-convert. */
+void trace_write_header(FILE *fout);
+/* Returns FALSE, writing nothing, if ref->pid is over TRACE_MAX_PID. */
+bool_t trace_write_ref(FILE *fout, const trace_ref_t *ref);
+
+/* The text trace access column (R, W, or I) for a ref_kind_t. */
+char trace_kind_char(ref_kind_t type);
+
+void trace_test();
+
+#endif /* TRACE_H */
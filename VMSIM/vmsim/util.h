@@ -17,15 +17,27 @@ static inline uint file_to_host_uint(uint tni4) {
 #define file_to_host_uint(i) (i)
 #endif
 
+/* The byte swap is its own inverse. */
+#define host_to_file_uint(i) file_to_host_uint(i)
+
 /* From K&R, 2nd Ed., pg. 49: get n bits from position p */
 static inline uint getbits(uint x, int p, int n) {
   return (x >> (p+1-n)) & ~(~0 << n);
 }
 
-static inline uint vaddr_to_vfn(vaddr_t vaddress) {
-  return getbits(vaddress, addr_space_bits-1, vfn_bits);
+/* The vfn of vaddress in an address space of addr_bits bits; any
+ * higher bits are ignored. */
+static inline vfn_t vaddr_to_vfn(vaddr_t vaddress, uint addr_bits,
+				 uint page_bits) {
+  if (addr_bits < ADDR_BITS_MAX)
+    vaddress &= ((vaddr_t)1 << addr_bits) - 1;
+  return vaddress >> page_bits;
 }
 
+/* Index of the lowest set bit of x, which must not be 0. */
+static inline uint first_set(unsigned long long x) {
+  return __builtin_ctzll(x);
+}
 
 uint log_2(uint x);
 uint pow_2(uint pow);
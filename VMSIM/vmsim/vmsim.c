@@ -10,83 +10,99 @@
 #include <physmem.h>
 #include <stats.h>
 #include <fault.h>
+#include <list.h>
+#include <heap.h>
+#include <arena.h>
+#include <trace.h>
+#include <mrc.h>
+#include <ws.h>
+#include <proc.h>
+#include <sim.h>
+#include <sweep.h>
+#include <rng.h>
+#include <opt.h>
 
-void init();
 void test();
-void simulate();
+void simulate(sim_t *sim);
 
 /* refs per '.' printed */
 uint dot_interval = 100;
 uint dots_per_line = 64;
 
-int ref_counter = 0;
-int r=0;
-
 int main(int argc, char **argv) {
+	sim_t *sim;
+
 	options_process(argc, argv);
 	if (opts.test) {
     		test();
    	 	printf("Tests done.\n");
     		exit(0);
   	}
-  
-  	init();
-  	simulate();
-  	stats_output();
+
+	if (opts.sweep) {
+		sweep_run();
+		return 0;
+	}
+
+  	sim = sim_new(&opts);
+  	simulate(sim);
+  	stats_output(sim);
+  	sim_free(sim);
   
 	return 0;
 }
 
-void init() {   
-  pagetable_init();
-  physmem_init();
-  stats_init();
-}
-
 void test() {
   printf("Running vmtrace tests...\n");
   util_test();
-  stats_init();
+  rng_test();
+  list_test();
+  heap_test();
+  arena_test();
+  trace_test();
   pagetable_test();
+  physmem_test();
+  proc_test();
+  fault_test();
+  opt_test();
+  mrc_test();
+  ws_test();
+  prefetch_test();
+  tlb_test();
+  huge_test();
+  sweep_test();
+  interval_test();
+  writeback_test();
 }
 
-ref_kind_t get_type(char c)
-{
-	if (c == 'R') return REF_KIND_LOAD;
-	if (c == 'W') return REF_KIND_STORE;
-	return REF_KIND_CODE;
-}
-
-
-void simulate() {
-  uint pid;
-  char ch;
-  vaddr_t vaddr;
-  ref_kind_t type;
-  pte_t *pte;
-  fault_handler_t handler;
+void simulate(sim_t *sim) {
+  trace_t *trace;
+  trace_ref_t ref;
   uint count = 0;
-  FILE *fin = NULL;	
-#ifdef DEBUG
-  char response[20];
-  uint pgfault=FALSE;
-#endif
-  
-  handler = opts.fault_handler->handler;
-  
-  if ((fin=fopen(opts.input_file, "r")) == NULL) {
-	  fprintf(stderr, "\n Could not open input file %s.", opts.input_file);
-	exit(1);
-  }
+  uint *opt_next = NULL;
+  PROFILE_VAR(t);
+
+  if (opt_needed(sim->opts.fault_handler))
+    sim->opt_next = opt_next = opt_index_read(&sim->opts);
+  trace = trace_open(sim->opts.input_file);
    printf("\n\nStarting simulation: ");
   printf("vaddr (Virtual Address) has %d bits, consisting of higher %d bits for vfn (Virtual Frame Number), and lower %d bits for offset within each page (log_2(pagesize=%d))\n",
-	addr_space_bits, vfn_bits, log_2(opts.pagesize), opts.pagesize);
-  while (fscanf(fin, "%d, %c, %x", &pid, &ch, &vaddr) !=EOF) {
-	  type = get_type(ch);
-	  stats_reference(type);
+	sim->opts.addr_bits, sim->opts.addr_bits - log_2(sim->opts.pagesize),
+	log_2(sim->opts.pagesize),
+	sim->opts.pagesize);
+#ifdef PROFILE
+  sim->profile = profile_new();
+  profile_start(sim->profile);
+#endif
+  while (1) {
+	  PROFILE_NEXT(sim->profile, count + 1);
+	  PROFILE_BEGIN(sim->profile, t);
+	  if (!trace_next(trace, &ref))
+		  break;
+	  PROFILE_END(sim->profile, PROFILE_PARSE, t);
 	  count++;
     
-	  if (opts.verbose && (count % dot_interval) == 0) {
+	  if (sim->opts.verbose && (count % dot_interval) == 0) {
 		  printf(".");
 		  fflush(stdout); 
 		  if ((count % (dots_per_line * dot_interval)) == 0) { 
@@ -94,50 +110,22 @@ void simulate() {
 			  fflush(stdout); 
 		  }
 	  }
-    
-    pte = pagetable_lookup_vaddr(vaddr_to_vfn(vaddr), type);
-#ifdef DEBUG
-    //printf("Got the count=%dth memory ref with pid:%d mode:%c vaddr:0x%x vfn:0x%x(=top %d bits of %d-bit vaddr)\n",
-//	count, pid, ch, vaddr, vaddr_to_vfn(vaddr), vfn_bits, addr_space_bits);
-    printf("\nGot the count=%dth memory ref with pid:%d mode:%c vaddr:0x%x vfn:0x%x\n",
-	count, pid, ch, vaddr, vaddr_to_vfn(vaddr));
-      pgfault=!pte->valid;
-      printf("\nGot a page %s. Do you want to dump out the page table and physmem? y or n: ", pgfault? "fault":"hit");
-      scanf("%s", response);
-#endif
-    if (!pte->valid) { /* Fault */
-      stats_miss(type);
-      handler(pte, type);
-	pte->c=r++;
-    } 
 
-    if(pte->valid) //for LFU and MFU , "chance" being modified for the Second chance algorithm
-    {	
-	pte->frequency = pte->frequency + 1;	
-	pte->used = 1;
-	pte->chance = 1;
-    }
-    
-    pte->reference = 1;
-    pte->counter = ref_counter++; //used by LRU
-
-    if (type == REF_KIND_STORE)
-      pte->modified = TRUE;
+    sim_reference(sim, &ref);
 
-#ifdef DEBUG
-   //printf("Page %s", pgfault? "Fault!\n": "Hit!\n");
-      if (response[0]=='Y' || response[0]=='y') {
-	pagetable_dump();
-	physmem_dump();
-	response[0]='N';
-      }
-#endif
-    if (opts.limit && count >= opts.limit) {
-      if (opts.verbose)
+    if (sim->opts.limit && count >= sim->opts.limit) {
+      if (sim->opts.verbose)
 	printf("\nvmsim: reached %d references\n", count);
       break;
     }
 
   }
+#ifdef PROFILE
+  profile_stop(sim->profile, count);
+#endif
+  trace_close(trace);
+  if (sim->interval)
+    interval_finish(sim->interval, sim->stats);
+  sim->opt_next = NULL;
+  free(opt_next);
 }
-
@@ -9,17 +9,26 @@
 typedef int bool_t;
 typedef unsigned char byte_t;
 
-typedef uint vaddr_t;
+typedef unsigned long long vaddr_t;
 typedef uint paddr_t;
+typedef vaddr_t vfn_t; /* virtual frame number */
 
 typedef enum _ref_kind {
   REF_KIND_CODE=0, REF_KIND_LOAD=1, REF_KIND_STORE=2
 } ref_kind_t;
 
 #define REF_KIND_NUM 3
-
-const static uint addr_space_bits = 16;
-extern uint vfn_bits;
-extern int ref_counter;
+/* Passed to page table lookups made by the prefetcher and huge page
+ * promotion, which are not references; never used to index statistics. */
+#define REF_KIND_PREFETCH REF_KIND_NUM
+
+/* Default for opts.addr_bits, the width of a virtual address. */
+#define ADDR_BITS_DEFAULT 16
+#define ADDR_BITS_MAX 64
+
+/* One simulation instance; see sim.h. */
+typedef struct _sim sim_t;
+/* One process (trace pid) of a simulation; see proc.h. */
+typedef struct _proc proc_t;
 
 #endif /* VMSIM_H */
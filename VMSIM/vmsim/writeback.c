@@ -0,0 +1,115 @@
+/*
+ * writeback.c - The background flusher. See writeback.h.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vmsim.h>
+#include <options.h>
+#include <pagetable.h>
+#include <stats.h>
+#include <list.h>
+#include <proc.h>
+#include <sim.h>
+#include <writeback.h>
+
+writeback_t *writeback_new(const opts_t *opts) {
+  writeback_t *wb = (writeback_t*)calloc(1, sizeof(writeback_t));
+  assert(wb);
+  list_init(&wb->dirty);
+  wb->limit = (ulong)opts->phys_pages * opts->flush_threshold / 100;
+  wb->rate = opts->flush_rate;
+  return wb;
+}
+
+void writeback_free(writeback_t *wb) {
+  free(wb);
+}
+
+void writeback_tick(sim_t *sim) {
+  writeback_t *wb = sim->writeback;
+  sim_t *frames;
+  pte_t *pte;
+
+  wb->credit += wb->rate;
+  while (wb->credit >= WRITEBACK_PERIOD && wb->dirty.size > wb->limit) {
+    pte = list_entry(list_front(&wb->dirty), pte_t, dirty);
+    list_remove(&wb->dirty, &pte->dirty);
+    pte->modified = FALSE;
+    frames = pte->proc->frames ? pte->proc->frames : sim;
+    frames->frametab.dirty[pte->pfn] = 0;
+    sim->stats->flushed++;
+    wb->credit -= WRITEBACK_PERIOD;
+  }
+  /* An idle flusher saves up at most one page's worth. */
+  if (wb->credit > WRITEBACK_PERIOD)
+    wb->credit = WRITEBACK_PERIOD;
+}
+
+/* LRU in frames frames at 100 ns a page in and 1000 a page out, with a
+ * flusher writing rate pages per WRITEBACK_PERIOD above threshold. */
+static sim_t *writeback_test_new(uint frames, uint rate, uint threshold) {
+  opts_t config;
+
+  sim_test_config(&config, "lru", frames);
+  config.cost = TRUE;
+  config.page_in_ns = 100;
+  config.page_out_ns = 1000;
+  config.flush_rate = rate;
+  config.flush_threshold = threshold;
+  return sim_new(&config);
+}
+
+/* Store to the first stores of 10 pages in 10 frames, then load them
+ * round and round up to refs references, checking at each that the
+ * flusher has kept to its rate. Half the frames may be dirty. */
+static sim_t *writeback_test_run(uint rate, int stores, int refs) {
+  sim_t *sim = writeback_test_new(10, rate, 50);
+  int i, page;
+
+  for (i = 0; i < refs; i++) {
+    page = i % 10;
+    sim_test_refs(sim, &page, i < stores ? "W" : "R", 1);
+    assert(sim->stats->flushed <= (count_t)(i + 1) * rate / WRITEBACK_PERIOD);
+  }
+  return sim;
+}
+
+void writeback_test() {
+  /* In 2 frames, all four fault; 0 is dirty when it makes way for 2 */
+  static const int pages[] = { 0, 1, 2, 0 };
+  sim_t *sim;
+
+  printf("Testing write-back\n");
+  /* 5 dirty pages of 10 is not above the threshold */
+  sim = writeback_test_run(10, 5, 5000);
+  assert(sim->stats->flushed == 0);
+  sim_free(sim);
+  /* 10 are; 3 a period are written until only 5 are left */
+  sim = writeback_test_run(3, 10, 1000);
+  assert(sim->stats->flushed == 3);
+  sim_free(sim);
+  sim = writeback_test_run(3, 10, 5000);
+  assert(sim->stats->flushed == 5 && sim->writeback->dirty.size == 5);
+  sim_free(sim);
+
+  /* Every fault stalls for a page in, and every dirty victim for a
+   * page out */
+  sim = writeback_test_new(2, 0, 0);
+  sim_test_refs(sim, pages, "WRRW", 4);
+  assert(stats_total(sim->stats->miss) == 4);
+  assert(sim->stats->stall_in == 4 * 100);
+  assert(stats_total(sim->stats->evict_dirty) == 1);
+  assert(sim->stats->stall_out == 1000);
+  sim_free(sim);
+  /* A flusher writing a page a reference cleans 0 before it goes, and
+   * 0 again after the last store */
+  sim = writeback_test_new(2, WRITEBACK_PERIOD, 0);
+  sim_test_refs(sim, pages, "WRRW", 4);
+  assert(sim->stats->stall_in == 4 * 100);
+  assert(stats_total(sim->stats->evict_dirty) == 0);
+  assert(sim->stats->stall_out == 0 && sim->stats->flushed == 2);
+  sim_free(sim);
+}
@@ -0,0 +1,47 @@
+/*
+ * writeback.h - The background flusher (-F RATE[:THRESHOLD]).
+ *
+ *               Resident dirty pages are listed in the order they were
+ *               dirtied. Whenever more than THRESHOLD percent of the frames
+ *               are dirty, the flusher writes back the oldest, up to RATE
+ *               pages per WRITEBACK_PERIOD references. Its writes are
+ *               asynchronous, so a page it has cleaned can later be evicted
+ *               without the synchronous page-out a dirty victim costs.
+ */
+
+#ifndef WRITEBACK_H
+#define WRITEBACK_H
+
+#include <vmsim.h>
+#include <options.h>
+#include <pagetable.h>
+#include <list.h>
+
+#define WRITEBACK_PERIOD 1000
+
+typedef struct _writeback {
+  list_t dirty;  /* resident dirty pages, on pte->dirty, oldest first */
+  uint limit;    /* dirty pages tolerated before the flusher writes */
+  uint rate;     /* pages written per WRITEBACK_PERIOD references */
+  uint credit;   /* rate accrued and not yet spent, in 1/PERIOD pages */
+} writeback_t;
+
+writeback_t *writeback_new(const opts_t *opts);
+void writeback_free(writeback_t *wb);
+
+/* A resident page was written while clean. */
+static inline void writeback_dirty(writeback_t *wb, pte_t *pte) {
+  list_push_back(&wb->dirty, &pte->dirty);
+}
+
+/* A dirty page is being evicted. */
+static inline void writeback_evict(writeback_t *wb, pte_t *pte) {
+  list_remove(&wb->dirty, &pte->dirty);
+}
+
+/* Run the flusher for one reference. */
+void writeback_tick(sim_t *sim);
+
+void writeback_test();
+
+#endif /* WRITEBACK_H */
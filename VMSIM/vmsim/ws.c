@@ -0,0 +1,129 @@
+/*
+ * ws.c - Track the working-set size. See ws.h.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <vmsim.h>
+#include <pagetable.h>
+#include <ws.h>
+
+/* One bucket of the series. */
+typedef struct _ws_point {
+  ulong end;     /* references up to the end of the bucket */
+  ulong sum;     /* working-set size summed over its references */
+  uint max;
+} ws_point_t;
+
+struct _ws {
+  pte_t **ring;  /* ring[t % window] is the page referenced at time t */
+  uint window;
+  uint size;     /* current working-set size */
+
+  ws_point_t points[WS_MAX_POINTS];
+  uint num_points; /* complete buckets */
+  ws_point_t cur;  /* the bucket being filled */
+  ulong width;     /* references per bucket */
+  ulong filled;    /* references in cur */
+};
+
+ws_t *ws_new(uint window) {
+  ws_t *ws = (ws_t*)calloc(1, sizeof(ws_t));
+  assert(ws && window > 0);
+  ws->ring = (pte_t**)calloc(window, sizeof(pte_t*));
+  assert(ws->ring);
+  ws->window = window;
+  ws->width = 1;
+  return ws;
+}
+
+void ws_free(ws_t *ws) {
+  free(ws->ring);
+  free(ws);
+}
+
+/* Halve the number of buckets by merging neighbours. */
+static void ws_merge(ws_t *ws) {
+  uint i;
+
+  for (i = 0; i < ws->num_points / 2; i++) {
+    ws->points[i].end = ws->points[2 * i + 1].end;
+    ws->points[i].sum = ws->points[2 * i].sum + ws->points[2 * i + 1].sum;
+    ws->points[i].max = ws->points[2 * i].max > ws->points[2 * i + 1].max ?
+      ws->points[2 * i].max : ws->points[2 * i + 1].max;
+  }
+  ws->num_points /= 2;
+  ws->width *= 2;
+}
+
+void ws_reference(ws_t *ws, pte_t *pte, int now) {
+  pte_t **slot = &ws->ring[now % ws->window];
+  int start = now - (int)ws->window; /* the window is (start, now] */
+
+  /* The page referenced at start leaves unless it was used again. */
+  if (*slot && (*slot)->counter == start)
+    ws->size--;
+  if (pte->counter <= start)
+    ws->size++;
+  *slot = pte;
+
+  ws->cur.sum += ws->size;
+  if (ws->size > ws->cur.max)
+    ws->cur.max = ws->size;
+  if (++ws->filled == ws->width) {
+    ws->cur.end = now + 1;
+    ws->points[ws->num_points++] = ws->cur;
+    ws->cur.sum = ws->cur.max = 0;
+    ws->filled = 0;
+    if (ws->num_points == WS_MAX_POINTS)
+      ws_merge(ws);
+  }
+}
+
+static void ws_output_point(FILE *o, const ws_point_t *p, ulong refs) {
+  fprintf(o, "\t%lu, %.1f, %u\n", p->end, (double)p->sum / refs, p->max);
+}
+
+void ws_output(ws_t *ws, FILE *o) {
+  uint i;
+
+  fprintf(o, "\n Working Set Size (window %u references, %lu per line):",
+	  ws->window, ws->width);
+  fprintf(o, "\n\treferences, mean, max\n");
+  for (i = 0; i < ws->num_points; i++)
+    ws_output_point(o, &ws->points[i], ws->width);
+  if (ws->filled) {
+    ws->cur.end = ws->num_points ? ws->points[i - 1].end + ws->filled :
+      ws->filled;
+    ws_output_point(o, &ws->cur, ws->filled);
+  }
+}
+
+void ws_test() {
+  static const int pages[] = { 0, 1, 0, 2, 2, 2, 3, 0 };
+  /* working-set sizes with a window of 3 */
+  static const uint sizes[] = { 1, 2, 2, 3, 2, 1, 2, 3 };
+  pte_t ptes[4];
+  ws_t *ws;
+  int t, i;
+
+  printf("Testing working set\n");
+  for (i = 0; i < 4; i++)
+    ptes[i].counter = PTE_NEVER_USED;
+  ws = ws_new(3);
+  for (t = 0; t < sizeof(pages) / sizeof(pages[0]); t++) {
+    ws_reference(ws, &ptes[pages[t]], t);
+    ptes[pages[t]].counter = t;
+    assert(ws->size == sizes[t]);
+  }
+  /* enough references to merge buckets; one page stays in the set */
+  for (i = 0; i < 3 * WS_MAX_POINTS; i++, t++) {
+    ws_reference(ws, &ptes[0], t);
+    ptes[0].counter = t;
+  }
+  assert(ws->size == 1);
+  assert(ws->width == 4 && ws->num_points == t / 4);
+  ws_free(ws);
+}
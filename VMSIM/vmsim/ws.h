@@ -0,0 +1,39 @@
+/*
+ * ws.h - Working-set size over time (-w WINDOW).
+ *
+ * The working set at time t is the set of distinct pages referenced in
+ * the last WINDOW references, (t - WINDOW, t]. Its size is kept exactly
+ * in O(1) per reference: a ring remembers the page referenced at each of
+ * the last WINDOW times, and the page referenced WINDOW references ago
+ * leaves the set unless its last-use time (pte->counter) shows it was
+ * referenced again since. Pages only prefetched are not in the set.
+ *
+ * The series is summarized in at most WS_MAX_POINTS buckets of equal
+ * width. When they run out, neighbouring buckets are merged and the width
+ * doubles, so a trace of any length gives a series of bounded size.
+ */
+
+#ifndef WS_H
+#define WS_H
+
+#include <stdio.h>
+#include <vmsim.h>
+#include <pagetable.h>
+
+#define WS_MAX_POINTS 1024
+
+typedef struct _ws ws_t;
+
+ws_t *ws_new(uint window);
+void ws_free(ws_t *ws);
+
+/* Account for a reference to pte at time now (sim->ref_counter). Called by
+ * sim_reference() for every reference, before pte->counter is updated. */
+void ws_reference(ws_t *ws, pte_t *pte, int now);
+
+/* Print the mean and largest working-set size of every bucket. */
+void ws_output(ws_t *ws, FILE *o);
+
+void ws_test();
+
+#endif /* WS_H */